@@ -13,7 +13,7 @@
  
  @Description
  This file contains the implementation of a custom memory allocator designed for low-end MCUs.
- In the header file the user can select between two allocation strategies USE_FISRT_FIT and USE_BEST_FIT.
+ In the header file the user can select between four allocation strategies USE_FISRT_FIT, USE_BEST_FIT, USE_TLSF and USE_BUDDY.
  Moreover CACHE_LINE_SIZE enables a padding before the structure allocation to prevent cache memory allignment invalidation.
  
  @License
@@ -31,10 +31,143 @@
  ************************************************************************** */
 
 
+#if defined MY_ALLOC_ARENA_BY_CPU && !defined _GNU_SOURCE
+#define _GNU_SOURCE // sched_getcpu()
+#endif
+#include <string.h>
 #include "MyAlloc.h"
 
-static char heap[MAX_HEAP_SIZE];
-static MY_ALLOC myAlloc;
+// The locks of the default heap are taken around fork(), so the child does not inherit a lock held by another thread
+#if (MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD || MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK) && (defined __unix__ || defined __APPLE__)
+#define MY_ALLOC_FORK_HANDLERS
+#endif
+
+// Statistics are counted by each thread when threads exist, otherwise by a single set of counters
+#if defined MY_ALLOC_USE_STATS && defined MY_ALLOC_FORK_HANDLERS
+#define MY_ALLOC_STATS_PER_THREAD
+#endif
+
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD || defined MY_ALLOC_USE_THREAD_CACHE || defined MY_ALLOC_FORK_HANDLERS
+#include <pthread.h>
+#endif
+#if (MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK && (defined __unix__ || defined __APPLE__)) || defined MY_ALLOC_ARENA_BY_CPU
+#include <sched.h>
+#endif
+#if defined MY_ALLOC_USE_MMAP
+#include <stdlib.h>
+#endif
+#if defined MY_ALLOC_USE_MMAP || defined MY_ALLOC_USE_PURGE || defined MY_ALLOC_USE_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+#if defined MY_ALLOC_USE_PURGE
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// With huge pages the heap starts on a huge page boundary, so no huge page is shared with other data
+#if defined MY_ALLOC_USE_HUGE_PAGES
+#define HEAP_ALIGNMENT          MY_ALLOC_HUGE_PAGE_SIZE
+#elif defined USE_BUDDY
+#define HEAP_ALIGNMENT          4096
+#else
+#define HEAP_ALIGNMENT          ALIGNMENT
+#endif
+
+// Bytes of the static heap before the first arena. A buddy block is aligned to its size, the first payload
+// starts on a HEAP_ALIGNMENT boundary so that the largest blocks do not depend on where the heap is linked
+#if defined USE_BUDDY
+#define HEAP_PREFIX             (HEAP_ALIGNMENT - METADATA_T_ALIGNED)
+#else
+#define HEAP_PREFIX             METADATA_T_OFFSET
+#endif
+
+#if defined MY_ALLOC_USE_MMAP
+static char* heap; // Reserved by myMalloc_Initialization()
+#if defined MY_ALLOC_USE_HUGETLB
+static bool heapMapped = false; // The heap is backed by the huge page pool and accessible at once
+#endif
+#else
+static char heap[HEAP_PREFIX + MAX_HEAP_SIZE] __attribute__((aligned(HEAP_ALIGNMENT)));
+#endif
+static MY_ALLOC arenas[MY_ALLOC_ARENAS];
+
+// Protects the lazy initialization of the arenas
+static MY_ALLOC_LOCK_T initLock = MY_ALLOC_LOCK_INITIALIZER;
+static bool heapReady = false;
+
+#if MY_ALLOC_ARENAS > 1 && !defined MY_ALLOC_ARENA_BY_CPU
+static _Thread_local MY_ALLOC* threadArena;
+static unsigned int nextArena = 0;
+#endif
+
+#if defined MY_ALLOC_USE_SLABS
+/*
+ * Header of a slab page, followed by the slots. Released slots are linked through their first word,
+ * slots never handed out are carved lazily from unused.
+ */
+typedef struct SLAB_PAGE_T {
+    struct SLAB_PAGE_T *prev;
+    struct SLAB_PAGE_T *next;
+    void* freeSlots;
+    char* unused;
+    uint32_t used;
+    uint32_t slotSize;
+} SLAB_PAGE_T;
+
+#define SLAB_PAGE_HEADER_SIZE       ALIGN(sizeof(SLAB_PAGE_T))
+
+// One bit for each page of the default heap, set when the page is a slab page
+#if defined MY_ALLOC_USE_MMAP
+static uint32_t* slabPageBitmap; // Sized at run time, it precedes the heap in the reservation
+#else
+static uint32_t slabPageBitmap[(MAX_HEAP_SIZE / SLAB_PAGE_SIZE + 2 + 31) / 32];
+#endif
+#endif
+
+#if defined MY_ALLOC_USE_THREAD_CACHE
+/*
+ * Cached blocks stay used in the block chain, each size is a stack linked through the payload.
+ * Their headers are not written out of the arena lock, neighbours update the same words while they coalesce.
+ */
+typedef struct {
+    METADATA_T* head[THREAD_CACHE_CLASSES];
+    uint32_t count[THREAD_CACHE_CLASSES];
+    bool registered;
+} THREAD_CACHE_T;
+
+static _Thread_local THREAD_CACHE_T threadCache;
+static pthread_key_t threadCacheKey;
+static pthread_once_t threadCacheOnce = PTHREAD_ONCE_INIT;
+#endif
+
+#if defined MY_ALLOC_USE_STATS
+/*
+ * Event counters of a thread, written by the thread only and summed by MyAlloc_GetStats()
+ */
+typedef struct THREAD_STATS_T {
+    uint64_t allocs[MY_ALLOC_STATS_CLASSES];
+    uint64_t frees[MY_ALLOC_STATS_CLASSES];
+    uint64_t splits;
+    uint64_t coalesces;
+    uint64_t failures;
+#if defined MY_ALLOC_STATS_PER_THREAD
+    struct THREAD_STATS_T *prev;
+    struct THREAD_STATS_T *next;
+    bool registered;
+#endif
+} THREAD_STATS_T;
+
+#if defined MY_ALLOC_STATS_PER_THREAD
+static _Thread_local THREAD_STATS_T threadStats;
+static THREAD_STATS_T* statsThreads; // Counters of the running threads
+static THREAD_STATS_T statsRetired; // Counters of the exited threads
+static MY_ALLOC_LOCK_T statsLock = MY_ALLOC_LOCK_INITIALIZER;
+static pthread_key_t statsKey;
+static pthread_once_t statsOnce = PTHREAD_ONCE_INIT;
+#else
+static THREAD_STATS_T threadStats;
+#endif
+#endif
 
 /* ************************************************************************** */
 /* ************************************************************************** */
@@ -43,324 +176,2930 @@ static MY_ALLOC myAlloc;
 /* ************************************************************************** */
 
 
+// Hint the processor that we are busy waiting
+#if defined __i386__ || defined __x86_64__
+#define CPU_RELAX()     __builtin_ia32_pause()
+#elif defined __aarch64__ || defined __arm__
+#define CPU_RELAX()     __asm__ __volatile__("yield")
+#else
+#define CPU_RELAX()     do { } while (0)
+#endif
+
+/**
+ @Function
+ static void lockAcquire(MY_ALLOC_LOCK_T* lock)
+ 
+ @Summary
+ Enters the critical section of a lock with the lock policy selected by MY_ALLOC_LOCK.
+ 
+ @Description
+ The spinlock first reads the lock word and only then tries to swap it, so waiting
+ threads do not bounce the cache line. After a failed attempt the number of busy-wait
+ rounds is doubled up to MY_ALLOC_SPIN_BACKOFF_MAX, then the processor is yielded.
+ */
+static inline void lockAcquire(MY_ALLOC_LOCK_T* lock) {
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+    pthread_mutex_lock(lock);
+#elif MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK
+    uint32_t backoff = 1, i;
+    while (__atomic_load_n(lock, __ATOMIC_RELAXED) || __atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < backoff; i++)
+            CPU_RELAX();
+        if (backoff < MY_ALLOC_SPIN_BACKOFF_MAX) {
+            backoff <<= 1;
+        } else {
+#if defined __unix__ || defined __APPLE__
+            sched_yield(); // The holder may be preempted, let it run
+#endif
+        }
+    }
+#elif MY_ALLOC_LOCK == MY_ALLOC_LOCK_USER
+    MyAlloc_EnterCritical();
+#else
+    (void) lock;
+#endif
+}
+
+static inline void lockRelease(MY_ALLOC_LOCK_T* lock) {
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+    pthread_mutex_unlock(lock);
+#elif MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+#elif MY_ALLOC_LOCK == MY_ALLOC_LOCK_USER
+    MyAlloc_ExitCritical();
+#else
+    (void) lock;
+#endif
+}
+
+// Lock a heap, unless it is an instance created without thread safety
+static inline void lockHeap(MY_ALLOC* alloc) {
+    if (alloc->threadSafe)
+        lockAcquire(&alloc->lock);
+}
+
+static inline void unlockHeap(MY_ALLOC* alloc) {
+    if (alloc->threadSafe)
+        lockRelease(&alloc->lock);
+}
+
+/**
+ @Function
+ static size_t getBlockSize(MY_ALLOC* alloc, METADATA_T* block).
+ 
+ @Summary
+ Returns the block size.
+ 
+ @Description
+ This function calculates and returns the block size.
+ The length is in bytes.
+ 
+ @Precondition
+ myMalloc_Initialization() must be called.
+ 
+ @Parameters
+ @param block Is the referred block which length is calculated.
+ 
+ @Returns
+ Return the length in bytes of the given block.
+ */
+static size_t getBlockSize(MY_ALLOC* alloc, METADATA_T* block) {
+#if defined MY_ALLOC_RELATIVE_HEADER
+    // The tail block also stores its distance to the end of the arena
+    (void) alloc;
+    return (size_t) block->next * ALIGNMENT - METADATA_T_ALIGNED;
+#else
+    size_t size;
+    
+    if (block->next == NULL) {
+        // No more blocks after this in the chain
+        if (block->prev == NULL)
+            size = alloc->heapSize - METADATA_T_ALIGNED; // Head (only) block
+        else
+            size = ((size_t)(alloc->heapEndAddress) - (size_t) (block)) - METADATA_T_ALIGNED;
+    } else {
+        // More blocks after this
+        size = ((size_t) (block->next) - (size_t) (block)) - METADATA_T_ALIGNED;
+    }
+    return size;
+#endif
+}
+
+// Conversions between a block and the payload handed out to the user
+static inline void* getPayload(METADATA_T* block) {
+    return (void*) (((char*) (block)) + METADATA_T_ALIGNED);
+}
+
+static inline METADATA_T* getBlock(void* ptr) {
+    return (METADATA_T*) (((char*) (ptr)) - METADATA_T_ALIGNED);
+}
+
+static inline FREE_NODE_T* getFreeNode(METADATA_T* block) {
+    return (FREE_NODE_T*) getPayload(block);
+}
+
+// Chain accessors, compact and boundary tag headers store distances in ALIGNMENT units instead of pointers
+#if defined MY_ALLOC_RELATIVE_HEADER
+// End of the block, i.e. the next header or the end of the arena
+static inline void* getNextBlockAddress(METADATA_T* block) {
+    return (void*) (((char*) (block)) + (size_t) block->next * ALIGNMENT);
+}
+
+static inline METADATA_T* getNextBlock(METADATA_T* block) {
+    return block->last ? NULL : (METADATA_T*) getNextBlockAddress(block);
+}
+
+static inline void setNextBlock(MY_ALLOC* alloc, METADATA_T* block, METADATA_T* next) {
+    size_t end = next ? (size_t) next : alloc->heapEndAddress;
+    block->next = (BLOCK_SIZE_T) ((end - (size_t) block) / ALIGNMENT);
+    block->last = next == NULL;
+}
+
+// The owner of a used block reads its header out of the arena lock (thread cache, stats),
+// the neighbours update the backward link in the same header under the lock, so both access it whole
+static inline METADATA_T loadHeader(METADATA_T* block) {
+    METADATA_T header;
+    __atomic_load(block, &header, __ATOMIC_RELAXED);
+    return header;
+}
+
+#if defined MY_ALLOC_BOUNDARY_TAGS
+static inline void setPrevFree(METADATA_T* block, bool prevFree) {
+    METADATA_T header = loadHeader(block);
+    header.prevFree = prevFree;
+    __atomic_store(block, &header, __ATOMIC_RELAXED);
+}
+
+// Only a free previous block can be reached, through the footer that precedes the header
+static inline METADATA_T* getPrevBlock(METADATA_T* block) {
+    return block->prevFree ? (METADATA_T*) (((char*) (block)) - ((size_t*) (block))[-1]) : NULL;
+}
+
+static inline void setPrevBlock(METADATA_T* block, METADATA_T* prev) {
+    setPrevFree(block, prev != NULL && prev->free);
+}
+#else
+static inline METADATA_T* getPrevBlock(METADATA_T* block) {
+    return block->prev == 0 ? NULL : (METADATA_T*) (((char*) (block)) - (size_t) block->prev * ALIGNMENT);
+}
+
+static inline void setPrevBlock(METADATA_T* block, METADATA_T* prev) {
+    METADATA_T header = loadHeader(block);
+    header.prev = prev ? (uint32_t) (((size_t) block - (size_t) prev) / ALIGNMENT) : 0;
+    __atomic_store(block, &header, __ATOMIC_RELAXED);
+}
+#endif
+
+// The requested size is not stored, the usable size is reported instead
+static inline size_t getBlockRequest(METADATA_T* block) {
+    return (size_t) loadHeader(block).next * ALIGNMENT - METADATA_T_ALIGNED;
+}
+
+static inline void setBlockRequest(METADATA_T* block, size_t size) {
+    (void) block;
+    (void) size;
+}
+#else
+static inline METADATA_T* getNextBlock(METADATA_T* block) {
+    return block->next;
+}
+
+static inline METADATA_T* getPrevBlock(METADATA_T* block) {
+    return block->prev;
+}
+
+static inline void setNextBlock(MY_ALLOC* alloc, METADATA_T* block, METADATA_T* next) {
+    (void) alloc; // Only relative headers need the end of the arena
+    block->next = next;
+}
+
+static inline void setPrevBlock(METADATA_T* block, METADATA_T* prev) {
+    block->prev = prev;
+}
+
+static inline size_t getBlockRequest(METADATA_T* block) {
+    return block->size;
+}
+
+static inline void setBlockRequest(METADATA_T* block, size_t size) {
+    block->size = (BLOCK_SIZE_T) size;
+}
+#endif
+
+// Round up requested bytes to be compatible with word processor allignment
+// This is not used for cache lines boundaries (see padding bytes instead)
+// A freed block must be able to host its free list node
+// Header and payload together keep the following payloads aligned
+static inline size_t getRequestLength(size_t size) {
+    size_t length = ALIGN(size + METADATA_T_ALIGNED) - METADATA_T_ALIGNED;
+    return length < MIN_PAYLOAD_SIZE ? MIN_PAYLOAD_SIZE : length;
+}
+
+// Payload bytes a used block may hold. A block served by the thread cache keeps the request of its previous use,
+// only the size class of the actual request is known, relative headers already report the usable size
+static inline size_t getBlockContent(METADATA_T* block) {
+#if defined MY_ALLOC_USE_THREAD_CACHE && !defined MY_ALLOC_RELATIVE_HEADER
+    return getRequestLength(getBlockRequest(block));
+#else
+    return getBlockRequest(block);
+#endif
+}
+
+// Index of the most significant bit set, size must not be zero
+static inline unsigned int log2Floor(size_t size) {
+    return (unsigned int) (sizeof(size_t) * 8 - 1 - __builtin_clzl(size));
+}
+
+#if defined MY_ALLOC_USE_STATS
+// A counter of a thread has a single writer, so it is incremented without a locked instruction
+#define STATS_ADD(counter, n)   __atomic_store_n(&(counter), __atomic_load_n(&(counter), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+// Adds the counters of from to the counters of to
+static void statsFold(THREAD_STATS_T* to, THREAD_STATS_T* from) {
+    unsigned int i;
+    
+    for (i = 0; i < MY_ALLOC_STATS_CLASSES; i++) {
+        to->allocs[i] += __atomic_load_n(&from->allocs[i], __ATOMIC_RELAXED);
+        to->frees[i] += __atomic_load_n(&from->frees[i], __ATOMIC_RELAXED);
+    }
+    to->splits += __atomic_load_n(&from->splits, __ATOMIC_RELAXED);
+    to->coalesces += __atomic_load_n(&from->coalesces, __ATOMIC_RELAXED);
+    to->failures += __atomic_load_n(&from->failures, __ATOMIC_RELAXED);
+}
+
+#if defined MY_ALLOC_STATS_PER_THREAD
+// The counters of an exiting thread are moved to the retired ones
+static void statsDestructor(void* arg) {
+    THREAD_STATS_T* local = (THREAD_STATS_T*) arg;
+    
+    lockAcquire(&statsLock);
+    statsFold(&statsRetired, local);
+    if (local->prev)
+        local->prev->next = local->next;
+    else
+        statsThreads = local->next;
+    if (local->next)
+        local->next->prev = local->prev;
+    memset(local, 0, sizeof(THREAD_STATS_T)); // A later release registers the thread again
+    lockRelease(&statsLock);
+}
+
+static void statsCreateKey(void) {
+    pthread_key_create(&statsKey, statsDestructor);
+}
+#endif
+
+// Counters of the calling thread, registered the first time they are used
+static inline THREAD_STATS_T* statsLocal(void) {
+#if defined MY_ALLOC_STATS_PER_THREAD
+    if (!threadStats.registered) {
+        pthread_once(&statsOnce, statsCreateKey);
+        pthread_setspecific(statsKey, &threadStats);
+        lockAcquire(&statsLock);
+        threadStats.prev = NULL;
+        threadStats.next = statsThreads;
+        if (statsThreads)
+            statsThreads->prev = &threadStats;
+        statsThreads = &threadStats;
+        threadStats.registered = true;
+        lockRelease(&statsLock);
+    }
+#endif
+    return &threadStats;
+}
+
+static inline bool isDefaultHeap(MY_ALLOC* alloc) {
+    return alloc >= arenas && alloc < arenas + MY_ALLOC_ARENAS;
+}
+
+// Accounts a new block of the chain, only the splits of the default heap are counted
+static inline void statsSplit(MY_ALLOC* alloc) {
+    alloc->blocks++;
+    if (isDefaultHeap(alloc))
+        STATS_ADD(statsLocal()->splits, 1);
+}
+
+// Accounts two blocks of the chain merged in one
+static inline void statsCoalesce(MY_ALLOC* alloc) {
+    alloc->blocks--;
+    if (isDefaultHeap(alloc))
+        STATS_ADD(statsLocal()->coalesces, 1);
+}
+
+#define STATS_SPLIT(alloc)      statsSplit(alloc)
+#define STATS_COALESCE(alloc)   statsCoalesce(alloc)
+#else
+#define STATS_SPLIT(alloc)
+#define STATS_COALESCE(alloc)
+#endif
+
+#if !defined MY_ALLOC_USE_FREE_TREE
+/**
+ @Function
+ static unsigned int getFreeListClass(size_t size)
+ 
+ @Summary
+ Returns the segregated list that holds free blocks of the given payload size.
+ 
+ @Parameters
+ @param size Is the payload size of a free block, not smaller than MIN_PAYLOAD_SIZE.
+ 
+ @Returns
+ Return the index of the free list, that is the power-of-two class of size,
+ with USE_TLSF the flat index of the first and second level class of size
+ or, with USE_BUDDY, the order of the block.
+ */
+static unsigned int getFreeListClass(size_t size) {
+#if defined USE_TLSF
+    unsigned int fl, sl;
+    
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        // Small blocks are linearly split in the first class
+        fl = 0;
+        sl = (unsigned int) (size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT));
+    } else {
+        fl = log2Floor(size);
+        sl = (unsigned int) (size >> (fl - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+        fl -= (TLSF_FL_INDEX_SHIFT - 1);
+    }
+    return fl * TLSF_SL_INDEX_COUNT + sl;
+#elif defined USE_BUDDY
+    return log2Floor(size + METADATA_T_ALIGNED);
+#else
+    return log2Floor(size);
+#endif
+}
+
+#if defined USE_BUDDY
+// Order of the smallest buddy block able to hold length payload bytes
+static inline unsigned int getBuddyOrder(size_t length) {
+    if (length < MIN_PAYLOAD_SIZE)
+        length = MIN_PAYLOAD_SIZE;
+    return log2Floor(length + METADATA_T_ALIGNED - 1) + 1;
+}
+
+// A block of order n spans 2^n bytes and its payload is aligned to 2^n, only the tail block of the arena may be longer
+static inline unsigned int getBlockOrder(MY_ALLOC* alloc, METADATA_T* block) {
+    return log2Floor(getBlockSize(alloc, block) + METADATA_T_ALIGNED);
+}
+
+// Link a new free block size bytes after block, the new block ends where block ended
+static METADATA_T* buddyCarve(MY_ALLOC* alloc, METADATA_T* block, size_t size) {
+    METADATA_T* newblock = (METADATA_T*) (((char*) (block)) + size);
+    
+    newblock->free = true;
+    newblock->zero = block->zero;
+    setBlockRequest(newblock, 0);
+    setPrevBlock(newblock, block);
+    setNextBlock(alloc, newblock, getNextBlock(block));
+    if (getNextBlock(newblock))
+        setPrevBlock(getNextBlock(newblock), newblock);
+    setNextBlock(alloc, block, newblock);
+    return newblock;
+}
+#endif
+
+// Mark a list as (non-)empty in the bitmaps
+static inline void setFreeListBit(MY_ALLOC* alloc, unsigned int index) {
+#if defined USE_TLSF
+    alloc->slBitmap[index / TLSF_SL_INDEX_COUNT] |= 1U << (index % TLSF_SL_INDEX_COUNT);
+    alloc->freeBitmap |= ((size_t) 1) << (index / TLSF_SL_INDEX_COUNT);
+#else
+    alloc->freeBitmap |= ((size_t) 1) << index;
+#endif
+}
+
+static inline void clearFreeListBit(MY_ALLOC* alloc, unsigned int index) {
+#if defined USE_TLSF
+    alloc->slBitmap[index / TLSF_SL_INDEX_COUNT] &= ~(1U << (index % TLSF_SL_INDEX_COUNT));
+    if (alloc->slBitmap[index / TLSF_SL_INDEX_COUNT] == 0)
+        alloc->freeBitmap &= ~(((size_t) 1) << (index / TLSF_SL_INDEX_COUNT));
+#else
+    alloc->freeBitmap &= ~(((size_t) 1) << index);
+#endif
+}
+#else
+static inline size_t treeHeight(METADATA_T* node) {
+    return node ? getFreeNode(node)->height : 0;
+}
+
+// Refresh the height and the lowest address of a node after its children changed
+static void treeUpdate(METADATA_T* node) {
+    FREE_NODE_T* n = getFreeNode(node);
+    size_t left = treeHeight(n->left), right = treeHeight(n->right);
+    
+    n->height = (left > right ? left : right) + 1;
+    n->lowest = node;
+    if (n->left && getFreeNode(n->left)->lowest < n->lowest)
+        n->lowest = getFreeNode(n->left)->lowest;
+    if (n->right && getFreeNode(n->right)->lowest < n->lowest)
+        n->lowest = getFreeNode(n->right)->lowest;
+}
+
+static METADATA_T* treeRotateRight(METADATA_T* node) {
+    METADATA_T* pivot = getFreeNode(node)->left;
+    
+    getFreeNode(node)->left = getFreeNode(pivot)->right;
+    getFreeNode(pivot)->right = node;
+    treeUpdate(node);
+    treeUpdate(pivot);
+    return pivot;
+}
+
+static METADATA_T* treeRotateLeft(METADATA_T* node) {
+    METADATA_T* pivot = getFreeNode(node)->right;
+    
+    getFreeNode(node)->right = getFreeNode(pivot)->left;
+    getFreeNode(pivot)->left = node;
+    treeUpdate(node);
+    treeUpdate(pivot);
+    return pivot;
+}
+
+// Restore the AVL property of a node whose subtrees differ in height by two at most, returns the new subtree root
+static METADATA_T* treeBalance(METADATA_T* node) {
+    FREE_NODE_T* n = getFreeNode(node);
+    
+    treeUpdate(node);
+    if (treeHeight(n->left) > treeHeight(n->right) + 1) {
+        if (treeHeight(getFreeNode(n->left)->right) > treeHeight(getFreeNode(n->left)->left))
+            n->left = treeRotateLeft(n->left);
+        return treeRotateRight(node);
+    }
+    if (treeHeight(n->right) > treeHeight(n->left) + 1) {
+        if (treeHeight(getFreeNode(n->right)->left) > treeHeight(getFreeNode(n->right)->right))
+            n->right = treeRotateRight(n->right);
+        return treeRotateLeft(node);
+    }
+    return node;
+}
+
+// Tree order, size first and address to break the ties
+static inline bool treeBefore(MY_ALLOC* alloc, METADATA_T* block, size_t size, METADATA_T* node) {
+    size_t nodeSize = getBlockSize(alloc, node);
+    return size < nodeSize || (size == nodeSize && block < node);
+}
+
+static METADATA_T* treeInsert(MY_ALLOC* alloc, METADATA_T* node, METADATA_T* block, size_t size) {
+    FREE_NODE_T* n;
+    
+    if (node == NULL) {
+        n = getFreeNode(block);
+        n->left = NULL;
+        n->right = NULL;
+        n->lowest = block;
+        n->height = 1;
+        return block;
+    }
+    n = getFreeNode(node);
+    if (treeBefore(alloc, block, size, node))
+        n->left = treeInsert(alloc, n->left, block, size);
+    else
+        n->right = treeInsert(alloc, n->right, block, size);
+    return treeBalance(node);
+}
+
+// Unlink the first node of a subtree and return it in first
+static METADATA_T* treeRemoveFirst(METADATA_T* node, METADATA_T** first) {
+    FREE_NODE_T* n = getFreeNode(node);
+    
+    if (n->left == NULL) {
+        *first = node;
+        return n->right;
+    }
+    n->left = treeRemoveFirst(n->left, first);
+    return treeBalance(node);
+}
+
+static METADATA_T* treeRemove(MY_ALLOC* alloc, METADATA_T* node, METADATA_T* block, size_t size) {
+    FREE_NODE_T* n = getFreeNode(node);
+    METADATA_T *successor, *right;
+    
+    if (node == block) {
+        // The successor, i.e. the first node of the right subtree, takes the place of the block
+        if (n->right == NULL)
+            return n->left;
+        right = treeRemoveFirst(n->right, &successor);
+        getFreeNode(successor)->left = n->left;
+        getFreeNode(successor)->right = right;
+        return treeBalance(successor);
+    }
+    if (treeBefore(alloc, block, size, node))
+        n->left = treeRemove(alloc, n->left, block, size);
+    else
+        n->right = treeRemove(alloc, n->right, block, size);
+    return treeBalance(node);
+}
+#endif
+
+/**
+ @Function
+ static size_t freeListLargest(MY_ALLOC* alloc)
+ 
+ @Summary
+ Returns the payload size of the largest free block.
+ 
+ @Description
+ With MY_ALLOC_USE_FREE_TREE the largest block is the last node of the tree,
+ otherwise only the highest non-empty list is scanned.
+ It is only needed when the largest block leaves the free lists, the size is kept in largestFree.
+ 
+ @Parameters
+ @param alloc Is the arena.
+ 
+ @Returns
+ Return the size in bytes of the largest free block or 0 if there is none.
+ */
+static size_t freeListLargest(MY_ALLOC* alloc) {
+#if defined MY_ALLOC_USE_FREE_TREE
+    METADATA_T* current = alloc->freeTree;
+    
+    if (current == NULL)
+        return 0;
+    while (getFreeNode(current)->right)
+        current = getFreeNode(current)->right;
+    return getBlockSize(alloc, current);
+#else
+    METADATA_T* current;
+    size_t size, largest = 0;
+    
+    if (alloc->freeBitmap == 0)
+        return 0;
+#if defined USE_TLSF
+    unsigned int fl = log2Floor(alloc->freeBitmap);
+    current = alloc->freelist[fl * TLSF_SL_INDEX_COUNT + log2Floor(alloc->slBitmap[fl])];
+#else
+    current = alloc->freelist[log2Floor(alloc->freeBitmap)];
+#endif
+    for (; current; current = getFreeNode(current)->next)
+        if ((size = getBlockSize(alloc, current)) > largest)
+            largest = size;
+    return largest;
+#endif
+}
+
+/**
+ @Function
+ static void freeListInsert(MY_ALLOC* alloc, METADATA_T* block)
+ 
+ @Summary
+ Links a free block at the head of its size class list.
+ 
+ @Description
+ The list node is stored in the unused payload of the block, therefore
+ the block size must be final (i.e., chain already updated) before calling this function.
+ With MY_ALLOC_USE_FREE_TREE the block is inserted in the free tree instead.
+ With boundary tags, the footer is written and the following block is flagged. The last block has no footer.
+ 
+ @Parameters
+ @param block Is the free block to link.
+ */
+static void freeListInsert(MY_ALLOC* alloc, METADATA_T* block) {
+    size_t size = getBlockSize(alloc, block);
+    
+    // Relaxed stores, MyAlloc_GetLargestFree() reads the totals without the lock
+    __atomic_store_n(&alloc->freeBytes, alloc->freeBytes + size, __ATOMIC_RELAXED);
+    if (size > alloc->largestFree)
+        __atomic_store_n(&alloc->largestFree, size, __ATOMIC_RELAXED);
+#if defined MY_ALLOC_USE_FREE_TREE
+    alloc->freeTree = treeInsert(alloc, alloc->freeTree, block, size);
+#else
+    unsigned int index = getFreeListClass(size);
+    FREE_NODE_T* node = getFreeNode(block);
+    
+    node->prev = NULL;
+    node->next = alloc->freelist[index];
+    if (node->next)
+        getFreeNode(node->next)->prev = block;
+    alloc->freelist[index] = block;
+    setFreeListBit(alloc, index);
+#endif
+#if defined MY_ALLOC_BOUNDARY_TAGS
+    // Write the footer and tell the following block, the last block has no follower reading its footer
+    if (getNextBlock(block)) {
+        ((size_t*) getNextBlockAddress(block))[-1] = (size_t) block->next * ALIGNMENT;
+        setPrevFree(getNextBlock(block), true);
+    }
+#endif
+}
+
+/**
+ @Function
+ static void freeListRemove(MY_ALLOC* alloc, METADATA_T* block)
+ 
+ @Summary
+ Unlinks a free block from its size class list.
+ 
+ @Description
+ The block size must still be the one used when the block was inserted.
+ 
+ @Parameters
+ @param block Is the free block to unlink.
+ */
+static void freeListRemove(MY_ALLOC* alloc, METADATA_T* block) {
+    size_t size = getBlockSize(alloc, block);
+    
+#if defined MY_ALLOC_USE_FREE_TREE
+    alloc->freeTree = treeRemove(alloc, alloc->freeTree, block, size);
+#else
+    FREE_NODE_T* node = getFreeNode(block);
+    
+    if (node->prev) {
+        getFreeNode(node->prev)->next = node->next;
+    } else {
+        unsigned int index = getFreeListClass(size);
+        alloc->freelist[index] = node->next;
+        if (node->next == NULL)
+            clearFreeListBit(alloc, index);
+    }
+    if (node->next)
+        getFreeNode(node->next)->prev = node->prev;
+#endif
+    __atomic_store_n(&alloc->freeBytes, alloc->freeBytes - size, __ATOMIC_RELAXED);
+    // Only the departure of the largest block needs a search, bounded by the highest list
+    if (size == alloc->largestFree)
+        __atomic_store_n(&alloc->largestFree, freeListLargest(alloc), __ATOMIC_RELAXED);
+#if defined MY_ALLOC_BOUNDARY_TAGS
+    // The footer is the only other dirty word of a zero block
+    if (getNextBlock(block)) {
+        if (block->zero)
+            ((size_t*) getNextBlockAddress(block))[-1] = 0;
+        setPrevFree(getNextBlock(block), false);
+    }
+#endif
+}
+
+#if !defined MY_ALLOC_USE_FREE_TREE
+/**
+ @Function
+ static METADATA_T* freeListFind(MY_ALLOC* alloc, unsigned int index)
+ 
+ @Summary
+ Returns the head of the first non-empty list starting from the given class.
+ 
+ @Description
+ The search only inspects the bitmaps, therefore it takes constant time.
+ 
+ @Parameters
+ @param index Is the first class to consider.
+ 
+ @Returns
+ Return the head of the list or NULL if all the lists from index on are empty.
+ */
+static METADATA_T* freeListFind(MY_ALLOC* alloc, unsigned int index) {
+    if (index >= FREE_LIST_CLASSES)
+        return NULL;
+#if defined USE_TLSF
+    unsigned int fl = index / TLSF_SL_INDEX_COUNT;
+    uint32_t slBitmap = alloc->slBitmap[fl] & (~0U << (index % TLSF_SL_INDEX_COUNT));
+    
+    if (slBitmap == 0) {
+        // No block in this first level, move to the next non-empty one
+        size_t flBitmap = (fl + 1 < TLSF_FL_INDEX_COUNT) ? alloc->freeBitmap & (~((size_t) 0) << (fl + 1)) : 0;
+        if (flBitmap == 0)
+            return NULL;
+        fl = (unsigned int) __builtin_ctzl(flBitmap);
+        slBitmap = alloc->slBitmap[fl];
+    }
+    return alloc->freelist[fl * TLSF_SL_INDEX_COUNT + (unsigned int) __builtin_ctz(slBitmap)];
+#else
+    size_t bitmap = alloc->freeBitmap & (~((size_t) 0) << index);
+    
+    if (bitmap == 0)
+        return NULL;
+    return alloc->freelist[__builtin_ctzl(bitmap)];
+#endif
+}
+#endif
+
+#if defined MY_ALLOC_USE_MMAP
+/**
+ @Function
+ static bool arenaCommit(MY_ALLOC* alloc, size_t end)
+ 
+ @Summary
+ Makes the reserved pages of an arena accessible up to the given address.
+ 
+ @Description
+ The committed part grows in steps of MY_ALLOC_MMAP_COMMIT_STEP and never beyond the end of the arena.
+ Fresh pages read as zero, so the free tail block keeps its zero flag.
+ 
+ @Parameters
+ @param alloc Is the arena.
+ @param end Is the first address that does not need to be accessible.
+ 
+ @Returns
+ Returns false if the system refuses to commit the pages.
+ */
+static bool arenaCommit(MY_ALLOC* alloc, size_t end) {
+    size_t start = alloc->committedEnd;
+    
+    if (end <= start)
+        return true;
+    end = (end + MY_ALLOC_MMAP_COMMIT_STEP - 1) & ~((size_t) MY_ALLOC_MMAP_COMMIT_STEP - 1);
+    if (end > alloc->heapEndAddress)
+        end = alloc->heapEndAddress;
+    if (mprotect((void*) start, end - start, PROT_READ | PROT_WRITE) != 0)
+        return false;
+    alloc->committedEnd = end;
+    return true;
+}
+#endif
+
+/**
+ @Function
+ static void arenaInitialization(MY_ALLOC* alloc, void* start, size_t size, bool zeroed)
+ 
+ @Summary
+ Initialization function used to prepare the linked list of an arena.
+ 
+ @Description
+ This function assigns the linked list to the new heap area
+ and initialize the head of the linked list.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param alloc Is the arena descriptor.
+ @param start Is the first byte of the arena, METADATA_T_OFFSET bytes after an ALIGNMENT boundary.
+ @param size Is the arena size in bytes, multiple of ALIGNMENT.
+ @param zeroed Is true if the arena memory is known to be zero filled.
+ */
+static void arenaInitialization(MY_ALLOC* alloc, void* start, size_t size, bool zeroed) {
+    // Assign the head of the linked list to the destination heap
+    memset(alloc, 0, sizeof(MY_ALLOC));
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+    pthread_mutex_init(&alloc->lock, NULL);
+#endif
+    alloc->threadSafe = true;
+    alloc->heapStartAddress = (size_t)(start);
+    alloc->heapEndAddress = (size_t)(start) + size;
+    alloc->heapSize = size;
+    alloc->requests = 0;
+#if defined MY_ALLOC_USE_MMAP
+    alloc->committedEnd = alloc->heapEndAddress; // The default heap commits its arenas lazily
+#endif
+    alloc->blocklist = (METADATA_T*) start;
+    // Initialize chain fields
+    setNextBlock(alloc, alloc->blocklist, NULL);
+    setPrevBlock(alloc->blocklist, NULL);
+    setBlockRequest(alloc->blocklist, 0);
+    alloc->blocklist->zero = zeroed;
+    alloc->blocklist->free = true; // Define the initial memory status, all free
+#if defined MY_ALLOC_USE_STATS
+    alloc->blocks = 1;
+#endif
+#if defined USE_BUDDY
+    // Carve the arena in the largest blocks whose payload is aligned to their size, the tail block also takes the remainder
+    // The space before the first aligned payload stays a free block out of the free lists
+    METADATA_T* block = alloc->blocklist;
+    size_t minBlock = (size_t) 1 << getBuddyOrder(MIN_PAYLOAD_SIZE);
+    size_t payload = (size_t) getPayload(block);
+    size_t end = alloc->heapEndAddress + METADATA_T_ALIGNED; // Payload address of a block at the end of the arena
+    size_t span;
+    if ((payload & (minBlock - 1)) != 0) {
+        span = ((payload + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE + minBlock - 1) & ~(minBlock - 1)) - payload;
+        if (end - payload < span + minBlock)
+            return; // Too small to hold an aligned block
+        block = buddyCarve(alloc, block, span);
+#if defined MY_ALLOC_BOUNDARY_TAGS
+        ((size_t*) block)[-1] = span; // Footer of the leading block
+#endif
+#if defined MY_ALLOC_USE_STATS
+        alloc->blocks++;
+#endif
+        payload += span;
+    }
+    for (;;) {
+        span = payload & -payload;
+        while (span > end - payload)
+            span >>= 1;
+        if (end - payload - span < minBlock)
+            break;
+        METADATA_T* next = buddyCarve(alloc, block, span);
+#if defined MY_ALLOC_USE_STATS
+        alloc->blocks++;
+#endif
+        freeListInsert(alloc, block);
+        block = next;
+        payload += span;
+    }
+    freeListInsert(alloc, block);
+#else
+    // The whole arena is the only free block
+    freeListInsert(alloc, alloc->blocklist);
+#endif
+}
+
+#if defined MY_ALLOC_FORK_HANDLERS
+// Fork handlers registered with pthread_atfork(), the locks are taken in a fixed order
+static void forkPrepare(void) {
+    unsigned int i;
+    
+    lockAcquire(&initLock);
+    for (i = 0; i < MY_ALLOC_ARENAS; i++)
+        lockAcquire(&arenas[i].lock);
+#if defined MY_ALLOC_STATS_PER_THREAD
+    lockAcquire(&statsLock); // Taken after an arena lock when a thread registers its counters
+#endif
+}
+
+static void forkParent(void) {
+    unsigned int i;
+    
+#if defined MY_ALLOC_STATS_PER_THREAD
+    lockRelease(&statsLock);
+#endif
+    for (i = MY_ALLOC_ARENAS; i > 0; i--)
+        lockRelease(&arenas[i - 1].lock);
+    lockRelease(&initLock);
+}
+
+static void forkChild(void) {
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+    unsigned int i;
+    
+    // Only the forking thread exists in the child, the mutexes are initialized again
+    pthread_mutex_init(&initLock, NULL);
+    for (i = 0; i < MY_ALLOC_ARENAS; i++)
+        pthread_mutex_init(&arenas[i].lock, NULL);
+#if defined MY_ALLOC_STATS_PER_THREAD
+    pthread_mutex_init(&statsLock, NULL);
+#endif
+#else
+    forkParent();
+#endif
+}
+#endif
+
+#if defined MY_ALLOC_USE_MMAP
+/**
+ @Function
+ static size_t heapReserve(void)
+ 
+ @Summary
+ Reserves the address space of the default heap.
+ 
+ @Description
+ The size is read from the MYALLOC_HEAP_SIZE environment variable, MAX_HEAP_SIZE is the default.
+ The reservation is not accessible, the arenas commit their pages as they grow.
+ With MY_ALLOC_USE_SLABS the slab page bitmap takes the committed beginning of the reservation.
+ With MY_ALLOC_USE_HUGE_PAGES the heap starts on a huge page boundary and is advised with MADV_HUGEPAGE.
+ With MY_ALLOC_USE_HUGETLB the heap is first mapped from the pool of huge pages, such mapping is accessible at once.
+ 
+ @Returns
+ Returns the size of the heap or zero if the address space cannot be reserved.
+ */
+static size_t heapReserve(void) {
+    const char* env = getenv(MY_ALLOC_HEAP_SIZE_ENV);
+    size_t size = MAX_HEAP_SIZE;
+    size_t prefix = 0, length;
+    char* base;
+    
+    if (env != NULL && strtoull(env, NULL, 0) > 0)
+        size = (size_t) strtoull(env, NULL, 0);
+#if defined MY_ALLOC_USE_SLABS
+    prefix = (size / SLAB_PAGE_SIZE + 2 + 31) / 32 * sizeof(uint32_t);
+    prefix = (prefix + MY_ALLOC_MMAP_COMMIT_STEP - 1) & ~((size_t) MY_ALLOC_MMAP_COMMIT_STEP - 1);
+#endif
+    if (size > SIZE_MAX - prefix - METADATA_T_OFFSET - HEAP_ALIGNMENT)
+        return 0;
+    length = prefix + METADATA_T_OFFSET + size;
+#if defined MY_ALLOC_USE_HUGETLB
+    // Huge pages are taken from the pool when the mapping is created, so no fault can find the pool empty
+    // The prefix is a multiple of the commit step, i.e. of the huge page, the heap starts on a huge page boundary
+    base = (char*) mmap(NULL, (length + HEAP_ALIGNMENT - 1) & ~((size_t) HEAP_ALIGNMENT - 1), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+#if defined MY_ALLOC_USE_SLABS
+        slabPageBitmap = (uint32_t*) base;
+#endif
+        heap = base + prefix;
+        heapMapped = true;
+        return size;
+    }
+#endif
+    // The reservation is larger than the heap by the alignment slack, the unused ends stay inaccessible
+    base = (char*) mmap(NULL, length + HEAP_ALIGNMENT, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+        return 0;
+    heap = (char*) (((size_t) base + prefix + HEAP_ALIGNMENT - 1) & ~((size_t) HEAP_ALIGNMENT - 1));
+#if defined MY_ALLOC_USE_SLABS
+    if (mprotect(heap - prefix, prefix, PROT_READ | PROT_WRITE) != 0) {
+        munmap(base, length + HEAP_ALIGNMENT);
+        return 0;
+    }
+    slabPageBitmap = (uint32_t*) (heap - prefix);
+#endif
+#if defined MY_ALLOC_USE_HUGE_PAGES
+    madvise(heap, METADATA_T_OFFSET + size, MADV_HUGEPAGE); // Only a hint, e.g. transparent huge pages may be disabled
+#endif
+    return size;
+}
+#endif
+
+/**
+ @Function
+ void myMalloc_Initialization (void)
+ 
+ @Summary
+ Initialization function used to prepare the arenas.
+ 
+ @Description
+ This function splits the heap in MY_ALLOC_ARENAS arenas of equal size,
+ the last one also takes the remainder of the division.
+ With MY_ALLOC_USE_MMAP the heap is reserved first and each arena commits the pages of its first block only.
+ With MY_ALLOC_USE_HUGE_PAGES the heap is advised to be backed by huge pages.
+ The arenas stay empty if the heap cannot be reserved, so every allocation fails.
+ It runs once, the first time the heap is used, and registers the fork handlers.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ None.
+ 
+ @Remarks
+ To use this functions you must declare the start heap address.
+ Use #define HEAP_START_ADDRESS to specify a physical address.
+ */
+static void myMalloc_Initialization(void) {
+    size_t heapSize = MAX_HEAP_SIZE;
+    size_t arenaSize, size;
+#if defined MY_ALLOC_FORK_HANDLERS
+    bool initialized = false;
+#endif
+    unsigned int i;
+    char* start;
+    
+    lockAcquire(&initLock);
+    if (!__atomic_load_n(&heapReady, __ATOMIC_RELAXED)) {
+#if defined MY_ALLOC_USE_MMAP
+        heapSize = heapReserve();
+#elif defined MY_ALLOC_USE_HUGE_PAGES
+        madvise(heap, sizeof(heap), MADV_HUGEPAGE); // Only a hint, e.g. transparent huge pages may be disabled
+#endif
+        arenaSize = (heapSize / MY_ALLOC_ARENAS) & ~((size_t) ALIGNMENT - 1);
+        for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+            start = heap + HEAP_PREFIX + i * arenaSize;
+            size = i + 1 < MY_ALLOC_ARENAS ? arenaSize : (heapSize & ~((size_t) ALIGNMENT - 1)) - i * arenaSize;
+#if defined MY_ALLOC_USE_MMAP
+            // Commit the first header and free list node, the first step may start in the previous arena
+            arenas[i].heapEndAddress = (size_t) start + size;
+            arenas[i].committedEnd = (size_t) start & ~((size_t) MY_ALLOC_MMAP_COMMIT_STEP - 1);
+            if (arenas[i].committedEnd < (size_t) heap)
+                arenas[i].committedEnd = (size_t) heap;
+#if defined MY_ALLOC_USE_HUGETLB
+            if (heapMapped)
+                arenas[i].committedEnd = arenas[i].heapEndAddress;
+#endif
+            if (heapSize == 0 || !arenaCommit(&arenas[i], (size_t) start + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE)) {
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+                pthread_mutex_init(&arenas[i].lock, NULL);
+#endif
+                continue;
+            }
+            size_t committedEnd = arenas[i].committedEnd;
+            arenaInitialization(&arenas[i], start, size, true);
+            arenas[i].committedEnd = committedEnd;
+#else
+            arenaInitialization(&arenas[i], start, size, true);
+#endif
+        }
+        
+        // Debug info, once for the whole default heap
+#ifdef MY_ALLOC_PRINT_DEBUG_INFO
+        printf("Heap start address: %p 0x%lX\r\n", arenas[0].blocklist, arenas[0].heapStartAddress);
+        printf("Heap end address: 0x%lX\r\n", arenas[MY_ALLOC_ARENAS - 1].heapEndAddress);
+        printf("Heap size: %lu bytes\r\n", heapSize);
+        
+        printf("Heap header size: %lu bytes\r\n", sizeof(METADATA_T));
+#endif
+        __atomic_store_n(&heapReady, true, __ATOMIC_RELEASE);
+#if defined MY_ALLOC_FORK_HANDLERS
+        initialized = true;
+#endif
+    }
+    lockRelease(&initLock);
+#if defined MY_ALLOC_FORK_HANDLERS
+    // Out of the lock, pthread_atfork() may call malloc(), i.e. myMalloc() when the preload library replaces it
+    if (initialized)
+        pthread_atfork(forkPrepare, forkParent, forkChild);
+#endif
+}
+
+// Initialize the heap the first time it is used
+static inline void checkInitialization(void) {
+    if (!__atomic_load_n(&heapReady, __ATOMIC_ACQUIRE))
+        myMalloc_Initialization();
+}
+
+/**
+ @Function
+ static MY_ALLOC* selectArena(void)
+ 
+ @Summary
+ Returns the arena assigned to the calling thread.
+ 
+ @Description
+ With MY_ALLOC_ARENA_BY_CPU the arena follows the CPU the thread is running on,
+ otherwise threads are assigned round-robin the first time they allocate.
+ */
+static inline MY_ALLOC* selectArena(void) {
+#if MY_ALLOC_ARENAS == 1
+    return &arenas[0];
+#elif defined MY_ALLOC_ARENA_BY_CPU
+    int cpu = sched_getcpu();
+    return &arenas[(cpu < 0 ? 0 : (unsigned int) cpu) % MY_ALLOC_ARENAS];
+#else
+    if (threadArena == NULL)
+        threadArena = &arenas[__atomic_fetch_add(&nextArena, 1, __ATOMIC_RELAXED) % MY_ALLOC_ARENAS];
+    return threadArena;
+#endif
+}
+
+/**
+ @Function
+ static MY_ALLOC* findArena(void* ptr)
+ 
+ @Summary
+ Returns the arena that owns a pointer.
+ 
+ @Parameters
+ @param ptr Is a pointer returned by myMalloc.
+ 
+ @Returns
+ Returns the arena whose address range contains ptr or NULL if ptr is outside the heap.
+ */
+static inline MY_ALLOC* findArena(void* ptr) {
+    unsigned int i;
+    
+    for (i = 0; i < MY_ALLOC_ARENAS; i++)
+        if ((size_t) ptr >= arenas[i].heapStartAddress && (size_t) ptr < arenas[i].heapEndAddress)
+            return &arenas[i];
+    return NULL;
+}
+
+#if defined USE_FIRST_FIT && defined MY_ALLOC_USE_FREE_TREE
+static METADATA_T* algorithmFirstFit(MY_ALLOC* alloc, size_t length) {
+    // First-fit implementation. A fitting node and its right subtree fit, the left subtree may hold lower addresses
+    METADATA_T *current = alloc->freeTree, *first = NULL;
+    while (current) {
+        FREE_NODE_T* node = getFreeNode(current);
+        if (getBlockSize(alloc, current) >= length) {
+            if (first == NULL || current < first)
+                first = current;
+            if (node->right && getFreeNode(node->right)->lowest < first)
+                first = getFreeNode(node->right)->lowest;
+            current = node->left;
+        } else {
+            current = node->right;
+        }
+    }
+    return first;
+}
+#elif defined USE_BEST_FIT && defined MY_ALLOC_USE_FREE_TREE
+static METADATA_T* algorithmBestFit(MY_ALLOC* alloc, size_t length) {
+    // Best-fit implementation. The first node not smaller than length is the tightest block at the lowest address
+    METADATA_T *current = alloc->freeTree, *smallest = NULL;
+    while (current) {
+        if (getBlockSize(alloc, current) >= length) {
+            smallest = current;
+            current = getFreeNode(current)->left;
+        } else {
+            current = getFreeNode(current)->right;
+        }
+    }
+    return smallest;
+}
+#elif defined USE_FIRST_FIT
+static METADATA_T* algorithmFirstFit(MY_ALLOC* alloc, size_t length) {
+    // First-fit implementation. Start from the size class of length
+    // Only the first list may contain blocks that are too small, every higher class fits
+    METADATA_T* current = alloc->freelist[getFreeListClass(length)];
+    while (current && getBlockSize(alloc, current) < length)
+        current = getFreeNode(current)->next;
+    if (current == NULL)
+        current = freeListFind(alloc, getFreeListClass(length) + 1);
+    return current;
+}
+#elif defined USE_BEST_FIT
+static METADATA_T* bestFitInList(MY_ALLOC* alloc, METADATA_T* current, size_t length) {
+    // Find the smallest block of the list that fits length
+    METADATA_T* smallest = NULL;
+    size_t block_size, size = alloc->heapSize;
+    while (current) {
+        block_size = getBlockSize(alloc, current);
+        if (block_size >= length && block_size < size) {
+            size = block_size;
+            smallest = current;
+            if (block_size == length)
+                break; // Exact fit, cannot do better
+        }
+        current = getFreeNode(current)->next;
+    }
+    return smallest;
+}
+
+static METADATA_T* algorithmBestFit(MY_ALLOC* alloc, size_t length) {
+    // Best-fit implementation. Inspect the free blocks of the size class of length first
+    // If none fits, the smallest block of the first non-empty class above is the best one
+    METADATA_T* smallest = bestFitInList(alloc, alloc->freelist[getFreeListClass(length)], length);
+    if (smallest == NULL)
+        smallest = bestFitInList(alloc, freeListFind(alloc, getFreeListClass(length) + 1), length);
+    return smallest;
+}
+#elif defined USE_TLSF
+static METADATA_T* algorithmTLSF(MY_ALLOC* alloc, size_t length) {
+    // Two-level segregated fit implementation. Round length up to the next second level boundary,
+    // then every block in the class of the rounded length or above fits without any scan
+    if (length >= TLSF_SMALL_BLOCK_SIZE)
+        length += (((size_t) 1) << (log2Floor(length) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    return freeListFind(alloc, getFreeListClass(length));
+}
+#elif defined USE_BUDDY
+static METADATA_T* algorithmBuddy(MY_ALLOC* alloc, size_t length) {
+    // Buddy system implementation. Every block of the order of length or above fits,
+    // the first non-empty order is split in halves by splitBlock()
+    return freeListFind(alloc, getBuddyOrder(length));
+}
+
+// Merge a block with the following one, its buddy. The buddy must already be out of the free lists
+static void buddyMerge(MY_ALLOC* alloc, METADATA_T* block, METADATA_T* buddy) {
+    STATS_COALESCE(alloc);
+    setNextBlock(alloc, block, getNextBlock(buddy));
+    if (getNextBlock(block))
+        setPrevBlock(getNextBlock(block), block);
+    // The buddy header and list node are the only dirty bytes of a zero block
+    if (block->zero && buddy->zero)
+        memset(buddy, 0, METADATA_T_ALIGNED + sizeof(FREE_NODE_T));
+    else
+        block->zero = false;
+}
+
+// Returns the buddy of a block when it is free and not split, NULL otherwise
+static METADATA_T* buddyFind(MY_ALLOC* alloc, METADATA_T* block, unsigned int order) {
+    size_t payload = (size_t) getPayload(block);
+    METADATA_T* buddy = getBlock((void*) (payload ^ ((size_t) 1 << order)));
+    
+    // The buddy is a neighbour in the chain, the tail block of the arena has no buddy after it
+    if (buddy != ((payload & ((size_t) 1 << order)) ? getPrevBlock(block) : getNextBlock(block)))
+        return NULL;
+    if (!buddy->free || getBlockOrder(alloc, buddy) != order)
+        return NULL;
+    return buddy;
+}
+#endif
+
+/**
+ @Function
+ static void splitBlock(MY_ALLOC* alloc, METADATA_T* current, size_t length)
+ 
+ @Summary
+ Returns the extra space of a used block to the free lists.
+ 
+ @Description
+ If the block is large enough, a new free block is created after the first length bytes.
+ The new block inherits the zero flag of the block and is merged with the following block when the latter is free.
+ With USE_BUDDY the block is halved down to the smallest order that holds length, the upper halves become free blocks.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena that owns the block.
+ @param current Is a used block.
+ @param length Is the payload size to keep, as returned by getRequestLength().
+ */
+static void splitBlock(MY_ALLOC* alloc, METADATA_T* current, size_t length) {
+#if defined USE_BUDDY
+    unsigned int order = getBlockOrder(alloc, current);
+    unsigned int target = getBuddyOrder(length);
+    
+    while (order > target) {
+        // The upper half is the buddy of the lower one, it cannot have a free buddy to merge with
+        order--;
+        freeListInsert(alloc, buddyCarve(alloc, current, (size_t) 1 << order));
+        STATS_SPLIT(alloc);
+    }
+#else
+    if (getBlockSize(alloc, current) < (length + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE))
+        return;
+    
+    // Create a new free block in current's extra space
+    METADATA_T* newblock = (METADATA_T*) (((char*) (current)) + length + METADATA_T_ALIGNED);
+    newblock->free = true;
+    newblock->zero = current->zero;
+    setBlockRequest(newblock, 0);
+    setPrevBlock(newblock, current);
+    setNextBlock(alloc, newblock, getNextBlock(current));
+    STATS_SPLIT(alloc);
+    if (getNextBlock(newblock) && getNextBlock(newblock)->free) {
+        // Absorb the following free block
+        METADATA_T* absorbed = getNextBlock(newblock);
+        STATS_COALESCE(alloc);
+        freeListRemove(alloc, absorbed);
+        setNextBlock(alloc, newblock, getNextBlock(absorbed));
+        // The absorbed header and list node are the only dirty bytes of a zero block
+        if (newblock->zero && absorbed->zero)
+            memset(absorbed, 0, METADATA_T_ALIGNED + sizeof(FREE_NODE_T));
+        else
+            newblock->zero = false;
+    }
+    if (getNextBlock(newblock))
+        setPrevBlock(getNextBlock(newblock), newblock);
+    // Refine current block's data
+    setNextBlock(alloc, current, newblock);
+    freeListInsert(alloc, newblock);
+#endif
+}
+
+/**
+ @Function
+ static void* allocateBlock(MY_ALLOC* alloc, size_t size, size_t alignment)
+ 
+ @Summary
+ Allocation core shared by the public functions.
+ 
+ @Description
+ Searches a free block with the selected algorithm, marks it as used and splits off its extra space.
+ When a stricter alignment is required, the leading slack stays in the free lists as a smaller free block.
+ 
+ @Precondition
+ myMalloc_Initialization() must be called and the arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena to allocate from.
+ @param size Is the minimum size of the allocated block, bigger than zero.
+ @param alignment Is the alignment of the payload, a power of two. ALIGNMENT or less selects the default one.
+ 
+ @Returns
+ Returns the payload of the block or NULL if no free block is large enough.
+ */
+static void* allocateBlock(MY_ALLOC* alloc, size_t size, size_t alignment) {
+    
+    size_t length, search, payload, aligned;
+    METADATA_T* current;
+    
+    length = getRequestLength(size);
+    search = length;
+#if defined USE_BUDDY
+    // The payload of a block of order n is aligned to 2^n, the order alone provides the alignment
+    if (search + METADATA_T_ALIGNED < alignment)
+        search = alignment - METADATA_T_ALIGNED;
+#else
+    // Room for the worst placement of an aligned payload, the leading slack must hold a free block
+    if (alignment > ALIGNMENT)
+        search += alignment + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE;
+#endif
+    
+    // Free space research algorithm
+#if defined USE_FIRST_FIT
+    current = algorithmFirstFit(alloc, search);
+#elif defined USE_BEST_FIT
+    current = algorithmBestFit(alloc, search);
+#elif defined USE_TLSF
+    current = algorithmTLSF(alloc, search);
+#elif defined USE_BUDDY
+    current = algorithmBuddy(alloc, search);
+#endif
+    
+    // Check that current is a valid METADATA_T* pointer, space may be over
+    if (current == NULL)
+        return NULL;
+#if defined MY_ALLOC_USE_MMAP
+    // The block may reach into the reserved pages, commit what the payload and the split are going to touch
+    if (!arenaCommit(alloc, (size_t) getPayload(current) + search + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE))
+        return NULL;
+#endif
+    
+    // Block found. Mark it as allocated
+    freeListRemove(alloc, current);
+    
+    payload = (size_t) getPayload(current);
+    aligned = (payload + alignment - 1) & ~(alignment - 1);
+    if (alignment > ALIGNMENT && aligned != payload) {
+        // Move the header right before the boundary, the leading slack remains a free block
+        while (aligned - payload < METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE)
+            aligned += alignment;
+        METADATA_T* block = (METADATA_T*) (aligned - METADATA_T_ALIGNED);
+        block->free = false;
+        block->zero = current->zero;
+        setPrevBlock(block, current);
+        setNextBlock(alloc, block, getNextBlock(current));
+        if (getNextBlock(block))
+            setPrevBlock(getNextBlock(block), block);
+        setNextBlock(alloc, current, block);
+        freeListInsert(alloc, current);
+        STATS_SPLIT(alloc);
+        current = block;
+    }
+    current->free = false;
+    setBlockRequest(current, size);
+    
+    // Check if block size is large enough to split
+    splitBlock(alloc, current, length);
+    
+    // Return a pointer to the beginning of the newly allocated block
+    void *rtn = getPayload(current);
+    alloc->requests += 1;
+    alloc->usedSize += getBlockSize(alloc, current) + METADATA_T_ALIGNED;
+#if defined MY_ALLOC_USE_STATS
+    if (alloc->usedSize > alloc->peakSize)
+        alloc->peakSize = alloc->usedSize;
+#endif
+    
+    return rtn;
+}
+
+/**
+ @Function
+ static void releaseBlock(MY_ALLOC* alloc, METADATA_T* block_to_free)
+ 
+ @Summary
+ Release core shared by the public functions.
+ 
+ @Description
+ Marks the block as free and coalesces it with its free neighbours.
+ With USE_BUDDY the block is only merged with its buddy, found by flipping the order bit of its payload address.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena that owns the block.
+ @param block_to_free Is a used block.
+ */
+static void releaseBlock(MY_ALLOC* alloc, METADATA_T* block_to_free) {
+    
+    alloc->usedSize -= getBlockSize(alloc, block_to_free) + METADATA_T_ALIGNED;
+    // Free current block, its content is dirty
+    block_to_free->free = true;
+    block_to_free->zero = false;
+    setBlockRequest(block_to_free, 0);
+    
+#if defined USE_BUDDY
+    // Merge with the buddy as long as it is free, each merge doubles the order
+    unsigned int order = getBlockOrder(alloc, block_to_free);
+    METADATA_T* buddy;
+    while ((buddy = buddyFind(alloc, block_to_free, order)) != NULL) {
+        freeListRemove(alloc, buddy);
+        if (buddy < block_to_free) {
+            buddyMerge(alloc, buddy, block_to_free);
+            block_to_free = buddy;
+        } else {
+            buddyMerge(alloc, block_to_free, buddy);
+        }
+        order++;
+    }
+    freeListInsert(alloc, block_to_free);
+#else
+    // Coalesce after each free
+    METADATA_T* previous_block = getPrevBlock(block_to_free);
+    METADATA_T* next_block = getNextBlock(block_to_free);
+    
+    // Free neighbours leave their list before their size changes, the merged block is linked again
+    if (previous_block && previous_block->free) {
+        freeListRemove(alloc, previous_block);
+        previous_block->zero = false;
+        // Combine previous, current, and next blocks
+        STATS_COALESCE(alloc);
+        if (next_block && next_block->free) {
+            // Combine previous and next block
+            freeListRemove(alloc, next_block);
+            STATS_COALESCE(alloc);
+            setNextBlock(alloc, previous_block, getNextBlock(next_block));
+            if (getNextBlock(next_block))
+                setPrevBlock(getNextBlock(next_block), previous_block);
+        } else {
+            // Combine previous and current blocks
+            setNextBlock(alloc, previous_block, next_block);
+            if (next_block)
+                setPrevBlock(next_block, previous_block);
+        }
+        freeListInsert(alloc, previous_block);
+    } else if (next_block && next_block->free) {
+        // Combine current and next blocks
+        freeListRemove(alloc, next_block);
+        STATS_COALESCE(alloc);
+        setNextBlock(alloc, block_to_free, getNextBlock(next_block));
+        if (getNextBlock(next_block))
+            setPrevBlock(getNextBlock(next_block), block_to_free);
+        freeListInsert(alloc, block_to_free);
+    } else {
+        freeListInsert(alloc, block_to_free);
+    }
+#endif
+    alloc->requests -= 1;
+}
+
+/**
+ @Function
+ static bool reallocateBlock(MY_ALLOC* alloc, METADATA_T* block, size_t size)
+ 
+ @Summary
+ Resizes a used block without moving it.
+ 
+ @Description
+ A shrinking block gives its tail back to the free lists. A growing block absorbs
+ the following block when the latter is free and large enough, then gives back the excess.
+ With USE_BUDDY a growing block absorbs its buddies, which must be free up to the new order.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena that owns the block.
+ @param block Is a used block.
+ @param size Is the new size of the block, bigger than zero.
+ 
+ @Returns
+ Returns true if the block has been resized in place, false if it must be moved.
+ */
+static bool reallocateBlock(MY_ALLOC* alloc, METADATA_T* block, size_t size) {
+    size_t length = getRequestLength(size);
+    size_t blockSize = getBlockSize(alloc, block);
+    METADATA_T* next_block = getNextBlock(block);
+    
+    // The content of a used block is dirty, so is the tail returned by splitBlock()
+    block->zero = false;
+    if (length > blockSize) {
+#if defined USE_BUDDY
+        // Grow by absorbing the following buddies, all of them must be free up to the new order
+        unsigned int order;
+        for (order = getBlockOrder(alloc, block); order < getBuddyOrder(length); order++) {
+            if (((size_t) getPayload(block) & ((size_t) 1 << order)) != 0 || next_block == NULL || !next_block->free
+                    || (char*) getPayload(next_block) != (char*) getPayload(block) + ((size_t) 1 << order) || getBlockOrder(alloc, next_block) != order)
+                return false;
+            next_block = getNextBlock(next_block);
+        }
+        while (getBlockSize(alloc, block) < length) {
+            next_block = getNextBlock(block);
+            freeListRemove(alloc, next_block);
+            buddyMerge(alloc, block, next_block);
+        }
+#else
+        // Grow by absorbing the following free block
+        if (next_block == NULL || !next_block->free || blockSize + METADATA_T_ALIGNED + getBlockSize(alloc, next_block) < length)
+            return false;
+#if defined MY_ALLOC_USE_MMAP
+        if (!arenaCommit(alloc, (size_t) getPayload(block) + length + METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE))
+            return false;
+#endif
+        freeListRemove(alloc, next_block);
+        STATS_COALESCE(alloc);
+        setNextBlock(alloc, block, getNextBlock(next_block));
+        if (getNextBlock(block))
+            setPrevBlock(getNextBlock(block), block);
+#endif
+    }
+    splitBlock(alloc, block, length);
+    setBlockRequest(block, size);
+    alloc->usedSize = alloc->usedSize - blockSize + getBlockSize(alloc, block);
+#if defined MY_ALLOC_USE_STATS
+    if (alloc->usedSize > alloc->peakSize)
+        alloc->peakSize = alloc->usedSize;
+#endif
+    return true;
+}
+
+#if defined MY_ALLOC_USE_REMOTE_FREE
+/**
+ @Function
+ static void remoteFreePush(MY_ALLOC* alloc, METADATA_T* block)
+ 
+ @Summary
+ Hands a used block over to the arena that owns it without taking its lock.
+ 
+ @Description
+ Multiple threads may push at the same time, only the arena drains the list.
+ The block stays used until the list is drained.
+ 
+ @Parameters
+ @param alloc Is the arena that owns the block.
+ @param block Is the used block to release.
+ */
+static void remoteFreePush(MY_ALLOC* alloc, METADATA_T* block) {
+    METADATA_T** next = (METADATA_T**) getPayload(block);
+    
+    *next = __atomic_load_n(&alloc->remoteFree, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&alloc->remoteFree, next, block, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ @Function
+ static void remoteFreeDrain(MY_ALLOC* alloc)
+ 
+ @Summary
+ Releases all the blocks pushed by other threads.
+ 
+ @Description
+ The whole list is detached with a single atomic exchange.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena to drain.
+ */
+static void remoteFreeDrain(MY_ALLOC* alloc) {
+    METADATA_T *block, *next;
+    
+    if (__atomic_load_n(&alloc->remoteFree, __ATOMIC_RELAXED) == NULL)
+        return;
+    block = __atomic_exchange_n(&alloc->remoteFree, NULL, __ATOMIC_ACQUIRE);
+    while (block) {
+        next = *((METADATA_T**) getPayload(block));
+        releaseBlock(alloc, block);
+        block = next;
+    }
+}
+#endif
+
+#if defined MY_ALLOC_USE_THREAD_CACHE
+/**
+ @Function
+ static void threadCacheFlush(THREAD_CACHE_T* cache, unsigned int index, uint32_t count)
+ 
+ @Summary
+ Returns a batch of cached blocks to the shared heap.
+ 
+ @Description
+ The arena lock is taken once for each run of blocks of the same arena.
+ 
+ @Parameters
+ @param cache Is the thread cache to flush.
+ @param index Is the size class to flush.
+ @param count Is the maximum number of blocks to release.
+ */
+static void threadCacheFlush(THREAD_CACHE_T* cache, unsigned int index, uint32_t count) {
+    METADATA_T* block;
+    MY_ALLOC *alloc = NULL, *owner;
+    
+    while (count-- && (block = cache->head[index]) != NULL) {
+        cache->head[index] = *((METADATA_T**) getPayload(block));
+        cache->count[index]--;
+        owner = findArena(block);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        if (owner != selectArena()) {
+            remoteFreePush(owner, block);
+            continue;
+        }
+#endif
+        if (owner != alloc) {
+            if (alloc)
+                unlockHeap(alloc);
+            alloc = owner;
+            lockHeap(alloc);
+        }
+        releaseBlock(alloc, block);
+    }
+    if (alloc)
+        unlockHeap(alloc);
+}
+
+// Called by POSIX threads on thread exit with the cache of the exiting thread
+static void threadCacheDestructor(void* arg) {
+    THREAD_CACHE_T* cache = (THREAD_CACHE_T*) arg;
+    unsigned int index;
+    
+    for (index = 0; index < THREAD_CACHE_CLASSES; index++)
+        if (cache->count[index])
+            threadCacheFlush(cache, index, cache->count[index]);
+}
+
+static void threadCacheCreateKey(void) {
+    pthread_key_create(&threadCacheKey, threadCacheDestructor);
+}
+
+/**
+ @Function
+ static void* threadCacheAllocate(size_t size)
+ 
+ @Summary
+ Serves an allocation from the cache of the calling thread.
+ 
+ @Description
+ The header is not written, the block keeps the request of its previous use, which has the same size class.
+ A cached block is always dirty, myCalloc() clears it entirely.
+ 
+ @Parameters
+ @param size Is the minimum size of the allocated block, bigger than zero.
+ 
+ @Returns
+ Returns the payload of a cached block or NULL if the cache has no block of this size.
+ */
+static void* threadCacheAllocate(size_t size) {
+    size_t length = getRequestLength(size);
+    METADATA_T* block;
+    
+    if (length > THREAD_CACHE_MAX_SIZE)
+        return NULL;
+    block = threadCache.head[length / ALIGNMENT];
+    if (block == NULL)
+        return NULL;
+    threadCache.head[length / ALIGNMENT] = *((METADATA_T**) getPayload(block));
+    threadCache.count[length / ALIGNMENT]--;
+    return getPayload(block);
+}
+
+/**
+ @Function
+ static bool threadCacheRelease(METADATA_T* block)
+ 
+ @Summary
+ Parks a used block in the cache of the calling thread.
+ 
+ @Description
+ When the size overflows THREAD_CACHE_DEPTH, THREAD_CACHE_BATCH blocks go back to the heap.
+ 
+ @Parameters
+ @param block Is the used block to release.
+ 
+ @Returns
+ Returns true if the block is cached, false if it is too large for the cache.
+ */
+static bool threadCacheRelease(METADATA_T* block) {
+    size_t length = getRequestLength(getBlockRequest(block));
+    unsigned int index = (unsigned int) (length / ALIGNMENT);
+    
+    if (length > THREAD_CACHE_MAX_SIZE)
+        return false;
+    if (!threadCache.registered) {
+        // Register the cache to be flushed when the thread exits
+        pthread_once(&threadCacheOnce, threadCacheCreateKey);
+        pthread_setspecific(threadCacheKey, &threadCache);
+        threadCache.registered = true;
+    }
+    *((METADATA_T**) getPayload(block)) = threadCache.head[index];
+    threadCache.head[index] = block;
+    if (++threadCache.count[index] > THREAD_CACHE_DEPTH)
+        threadCacheFlush(&threadCache, index, THREAD_CACHE_BATCH);
+    return true;
+}
+#endif
+
+#if defined MY_ALLOC_USE_SLABS
+// Index of the page of ptr in slabPageBitmap
+static inline size_t slabPageIndex(void* ptr) {
+    return ((size_t) ptr - ((size_t) heap & ~((size_t) SLAB_PAGE_SIZE - 1))) / SLAB_PAGE_SIZE;
+}
+
+/**
+ @Function
+ static SLAB_PAGE_T* slabFind(void* ptr)
+ 
+ @Summary
+ Returns the slab page that contains a pointer.
+ 
+ @Description
+ The bit of a page does not change while one of its slots is in use, so no lock is required.
+ 
+ @Parameters
+ @param ptr Is a pointer returned by myMalloc.
+ 
+ @Returns
+ Returns the slab page or NULL if ptr belongs to a block of the chain.
+ */
+static SLAB_PAGE_T* slabFind(void* ptr) {
+    size_t index;
+#if defined MY_ALLOC_USE_MMAP
+    size_t end = arenas[MY_ALLOC_ARENAS - 1].heapEndAddress;
+#else
+    size_t end = (size_t) heap + sizeof(heap);
+#endif
+    
+    if ((size_t) ptr < (size_t) heap || (size_t) ptr >= end)
+        return NULL;
+    index = slabPageIndex(ptr);
+    if ((__atomic_load_n(&slabPageBitmap[index / 32], __ATOMIC_RELAXED) & (1U << (index % 32))) == 0)
+        return NULL;
+    return (SLAB_PAGE_T*) ((size_t) ptr & ~((size_t) SLAB_PAGE_SIZE - 1));
+}
+
+// Link and unlink a page in the list of its class
+static void slabListInsert(MY_ALLOC* alloc, SLAB_PAGE_T* page) {
+    unsigned int index = page->slotSize / ALIGNMENT;
+    
+    page->prev = NULL;
+    page->next = alloc->slabs[index];
+    if (page->next)
+        page->next->prev = page;
+    alloc->slabs[index] = page;
+}
+
+static void slabListRemove(MY_ALLOC* alloc, SLAB_PAGE_T* page) {
+    if (page->prev)
+        page->prev->next = page->next;
+    else
+        alloc->slabs[page->slotSize / ALIGNMENT] = page->next;
+    if (page->next)
+        page->next->prev = page->prev;
+}
+
+// A page without free slots is not linked in the list of its class
+static inline bool slabPageFull(SLAB_PAGE_T* page) {
+    return page->freeSlots == NULL && page->unused + page->slotSize > (char*) page + SLAB_PAGE_SIZE;
+}
+
+// Give an empty page back to the arena
+static void slabPageRelease(MY_ALLOC* alloc, SLAB_PAGE_T* page) {
+    size_t index = slabPageIndex(page);
+    
+    slabListRemove(alloc, page);
+    __atomic_fetch_and(&slabPageBitmap[index / 32], ~(1U << (index % 32)), __ATOMIC_RELAXED);
+    releaseBlock(alloc, getBlock(page));
+}
+
+// Give the spare pages back to the arena, the arena lock must be held
+static void slabTrim(MY_ALLOC* alloc) {
+    unsigned int index;
+    
+    for (index = 0; index < SLAB_CLASSES; index++) {
+        if (alloc->slabSpare[index]) {
+            slabPageRelease(alloc, alloc->slabSpare[index]);
+            alloc->slabSpare[index] = NULL;
+        }
+    }
+}
+
+/**
+ @Function
+ static void* slabAllocate(MY_ALLOC* alloc, size_t size)
+ 
+ @Summary
+ Hands out a slot of the class of size.
+ 
+ @Description
+ When the class has no page with free slots, a new page aligned to SLAB_PAGE_SIZE is carved from the arena.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena to allocate from.
+ @param size Is the requested size, not bigger than SLAB_MAX_SIZE.
+ 
+ @Returns
+ Returns the slot or NULL if the arena cannot hold a new page.
+ */
+static void* slabAllocate(MY_ALLOC* alloc, size_t size) {
+    size_t slotSize = ALIGN(size) < ALIGN(sizeof(void*)) ? ALIGN(sizeof(void*)) : ALIGN(size);
+    unsigned int index = (unsigned int) (slotSize / ALIGNMENT);
+    SLAB_PAGE_T* page = alloc->slabs[index];
+    void* slot;
+    
+    if (page == NULL) {
+        if ((page = (SLAB_PAGE_T*) allocateBlock(alloc, SLAB_PAGE_SIZE, SLAB_PAGE_SIZE)) == NULL) {
+            slabTrim(alloc); // Spare pages of other classes may be fragmenting the arena
+            if ((page = (SLAB_PAGE_T*) allocateBlock(alloc, SLAB_PAGE_SIZE, SLAB_PAGE_SIZE)) == NULL)
+                return NULL;
+        }
+        size_t bit = slabPageIndex(page);
+        page->freeSlots = NULL;
+        page->unused = (char*) page + SLAB_PAGE_HEADER_SIZE;
+        page->used = 0;
+        page->slotSize = (uint32_t) slotSize;
+        slabListInsert(alloc, page);
+        __atomic_fetch_or(&slabPageBitmap[bit / 32], 1U << (bit % 32), __ATOMIC_RELAXED);
+    }
+    if (page == alloc->slabSpare[index])
+        alloc->slabSpare[index] = NULL;
+    
+    if (page->freeSlots) {
+        slot = page->freeSlots;
+        page->freeSlots = *((void**) slot);
+    } else {
+        slot = page->unused;
+        page->unused += slotSize;
+    }
+    page->used++;
+    if (slabPageFull(page))
+        slabListRemove(alloc, page);
+    return slot;
+}
+
+/**
+ @Function
+ static void slabRelease(MY_ALLOC* alloc, SLAB_PAGE_T* page, void* slot)
+ 
+ @Summary
+ Returns a slot to its page.
+ 
+ @Description
+ One empty page is kept for each class, other empty pages go back to the arena.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena that owns the page.
+ @param page Is the page of the slot, as returned by slabFind().
+ @param slot Is the slot to release.
+ */
+static void slabRelease(MY_ALLOC* alloc, SLAB_PAGE_T* page, void* slot) {
+    unsigned int index = page->slotSize / ALIGNMENT;
+    
+    if (slabPageFull(page))
+        slabListInsert(alloc, page);
+    *((void**) slot) = page->freeSlots;
+    page->freeSlots = slot;
+    if (--page->used == 0) {
+        if (alloc->slabSpare[index] == NULL)
+            alloc->slabSpare[index] = page;
+        else
+            slabPageRelease(alloc, page);
+    }
+}
+
+#endif
+
+#if defined MY_ALLOC_USE_PURGE
+/**
+ @Function
+ static size_t arenaPurge(MY_ALLOC* alloc)
+ 
+ @Summary
+ Returns the whole pages of the free blocks of an arena to the system.
+ 
+ @Description
+ The pages after the list node of each dirty free block are released with madvise(MADV_DONTNEED),
+ they read as zero when they are touched again. The bytes around the released pages are cleared,
+ so the block is flagged as zero and the next pass skips it. Spare slab pages are released first.
+ 
+ @Precondition
+ The arena lock must be held.
+ 
+ @Parameters
+ @param alloc Is the arena to purge.
+ 
+ @Returns
+ Returns the number of bytes released.
+ */
+static size_t arenaPurge(MY_ALLOC* alloc) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t purged = 0, start, end, first, last;
+    METADATA_T* block;
+    
+#if defined MY_ALLOC_USE_REMOTE_FREE
+    remoteFreeDrain(alloc);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+    slabTrim(alloc);
+#endif
+    for (block = alloc->blocklist; block != NULL; block = getNextBlock(block)) {
+        if (!block->free || block->zero)
+            continue;
+        start = (size_t) getPayload(block) + sizeof(FREE_NODE_T);
+        end = (size_t) getPayload(block) + getBlockSize(alloc, block);
+#if defined MY_ALLOC_BOUNDARY_TAGS
+        if (getNextBlock(block))
+            end -= sizeof(size_t); // The footer stays
+#endif
+#if defined MY_ALLOC_USE_MMAP
+        if (end > alloc->committedEnd)
+            end = alloc->committedEnd; // Reserved pages are zero filled when they are committed
+#endif
+        first = (start + page - 1) & ~(page - 1);
+        last = end & ~(page - 1);
+        if (first >= last || madvise((void*) first, last - first, MADV_DONTNEED) != 0)
+            continue;
+        memset((void*) start, 0, first - start);
+        memset((void*) last, 0, end - last);
+        block->zero = true;
+        purged += last - first;
+    }
+    return purged;
+}
+
+#if MY_ALLOC_PURGE_DECAY_MS > 0
+// Runs the purge pass on an arena once every MY_ALLOC_PURGE_DECAY_MS, the clock is read every MY_ALLOC_PURGE_CHECK frees
+static void purgeDecay(MY_ALLOC* alloc) {
+    struct timespec now;
+    uint64_t time;
+    
+    if (++alloc->purgeFrees < MY_ALLOC_PURGE_CHECK)
+        return;
+    alloc->purgeFrees = 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    time = (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+    if (alloc->purgeTime == 0) {
+        alloc->purgeTime = time; // Blocks freed before the first reading get a whole period
+    } else if (time - alloc->purgeTime >= MY_ALLOC_PURGE_DECAY_MS) {
+        arenaPurge(alloc);
+        alloc->purgeTime = time;
+    }
+}
+#endif
+#endif
+
+// Takes the zero flag of a block just allocated, the arena lock must be held
+static inline bool consumeZero(void* ptr) {
+    METADATA_T* block = getBlock(ptr);
+    bool zero = block->zero;
+    
+    block->zero = false;
+    return zero;
+}
+
+/**
+ @Function
+ static void clearPayload(void* ptr, size_t size, bool zero)
+ 
+ @Summary
+ Zeroes the payload of a new block.
+ 
+ @Description
+ A block carved from zero memory is dirty only where its free list node was,
+ any other block (a cached block or a slab slot) is cleared entirely.
+ The header is not read, the zero flag is taken with consumeZero() under the arena lock.
+ 
+ @Parameters
+ @param ptr Is the payload returned by the allocation.
+ @param size Is the requested size.
+ @param zero Is the zero flag of the block.
+ */
+static void clearPayload(void* ptr, size_t size, bool zero) {
+    if (zero && size > sizeof(FREE_NODE_T))
+        size = sizeof(FREE_NODE_T);
+    memset(ptr, 0, size);
+}
+
+#if defined MY_ALLOC_USE_STATS
+// Size class of a pointer of the default heap, the usable size is the same when it is allocated and released
+static unsigned int statsClass(MY_ALLOC* alloc, void* ptr) {
+#if defined MY_ALLOC_USE_SLABS
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page)
+        return log2Floor(page->slotSize);
+#endif
+#if defined MY_ALLOC_RELATIVE_HEADER
+    // Same as the block size, without reading the words that the neighbours update
+    return log2Floor(getBlockRequest(getBlock(ptr)));
+#else
+    return log2Floor(getBlockSize(alloc, getBlock(ptr)));
+#endif
+}
+
+// Accounts an allocation of the default heap, NULL is a failed one
+static inline void statsAllocated(void* ptr) {
+    if (ptr == NULL)
+        STATS_ADD(statsLocal()->failures, 1);
+    else
+        STATS_ADD(statsLocal()->allocs[statsClass(findArena(ptr), ptr)], 1);
+}
+#endif
+
+/**
+ @Function
+ static void* arenasAllocate(size_t size, size_t alignment, bool* zero)
+ 
+ @Summary
+ Allocates from the arena of the calling thread, then from the other arenas.
+ 
+ @Parameters
+ @param size Is the minimum size of the allocated block, bigger than zero.
+ @param alignment Is the alignment of the payload, a power of two.
+ @param zero If not NULL, receives the zero flag of the block, taken under the arena lock.
+ 
+ @Returns
+ Returns the payload of the block or NULL if every arena is full.
+ */
+static void* arenasAllocate(size_t size, size_t alignment, bool* zero) {
+    void* rtn;
+    
+    // Initialize pointer chain
+    checkInitialization();
+    
+    MY_ALLOC* alloc = selectArena();
+    lockHeap(alloc);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+    remoteFreeDrain(alloc);
+#endif
+    rtn = allocateBlock(alloc, size, alignment);
+    if (rtn != NULL && zero != NULL)
+        *zero = consumeZero(rtn);
+    unlockHeap(alloc);
+    
+#if MY_ALLOC_ARENAS > 1
+    // The arena of the thread is full, try the other ones
+    unsigned int i, first = (unsigned int) (alloc - arenas);
+    for (i = 1; rtn == NULL && i < MY_ALLOC_ARENAS; i++) {
+        alloc = &arenas[(first + i) % MY_ALLOC_ARENAS];
+        lockHeap(alloc);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        remoteFreeDrain(alloc);
+#endif
+        rtn = allocateBlock(alloc, size, alignment);
+        if (rtn != NULL && zero != NULL)
+            *zero = consumeZero(rtn);
+        unlockHeap(alloc);
+    }
+#endif
+#if defined MY_ALLOC_USE_STATS
+    statsAllocated(rtn);
+#endif
+    
+    return rtn;
+}
+
+/**
+ @Function
+ static void* defaultAllocate(size_t size, bool* zero)
+ 
+ @Summary
+ Allocates from the slabs, the thread cache or the arenas.
+ 
+ @Parameters
+ @param size Is the minimum size of the allocated block.
+ @param zero If not NULL, receives true if the payload is clean but the free list node.
+ 
+ @Returns
+ Returns the payload of the block or NULL if the function fails.
+ */
+static void* defaultAllocate(size_t size, bool* zero) {
+    
+    // Check required space is bigger than zero
+    if (size <= 0)
+        return NULL;
+    
+#if defined MY_ALLOC_USE_THREAD_CACHE || defined MY_ALLOC_USE_SLABS
+    void* rtn;
+#endif
+#if defined MY_ALLOC_USE_SLABS
+    // Slabs come first, the thread cache holds only blocks of the chain
+    if (size <= SLAB_MAX_SIZE) {
+        checkInitialization();
+        MY_ALLOC* alloc = selectArena();
+        lockHeap(alloc);
+        rtn = slabAllocate(alloc, size);
+        unlockHeap(alloc);
+        if (rtn != NULL) {
+            if (zero != NULL)
+                *zero = false;
+#if defined MY_ALLOC_USE_STATS
+            statsAllocated(rtn);
+#endif
+            return rtn;
+        }
+    }
+#endif
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    if ((rtn = threadCacheAllocate(size)) != NULL) {
+        if (zero != NULL)
+            *zero = false;
+#if defined MY_ALLOC_USE_STATS
+        statsAllocated(rtn);
+#endif
+        return rtn;
+    }
+#endif
+    return arenasAllocate(size, ALIGNMENT, zero);
+}
+
+/* ************************************************************************** */
+/* ************************************************************************** */
+// Section: Public Functions                                                  */
+/* ************************************************************************** */
+/* ************************************************************************** */
+
+
+/**
+ @Function
+ void* myMalloc(size_t size)
+ 
+ @Summary
+ Returns a pointer to a new memory allocated block.
+ 
+ @Description
+ This function returns a void pointer to a new memory allocated block of size size.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param size Is the minimum size of the allocated block.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails.
+ */
+void* myMalloc(size_t size) {
+    return defaultAllocate(size, NULL);
+}
+
+/**
+ @Function
+ void myFree(void* ptr)
+ 
+ @Summary
+ Release a previous allocated memory.
+ 
+ @Description
+ This function releases a previous allocated piece of dynamic memory.
+ 
+ @Precondition
+ MyMalloc must be called and returns successully.
+ 
+ @Parameters
+ @param ptr Is the pointer to the block to release.
+ 
+ */
+void myFree(void* ptr) {
+    
+    // Sanity check before continue
+    if (ptr == NULL)
+        return;
+    
+    // Find the block that we want to free from the pointer parameter (pointer math)
+    METADATA_T* block_to_free = getBlock(ptr);
+    
+    // Route the block to the arena that owns its address
+    MY_ALLOC* alloc = findArena(ptr);
+    
+    // Return if invalid block
+    if (alloc == NULL) {
+        //printf("Error block at %p not found\n", ptr);
+        return;
+    }
+#if defined MY_ALLOC_USE_STATS
+    STATS_ADD(statsLocal()->frees[statsClass(alloc, ptr)], 1);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+    // Slots have no header, they go back to their page
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page) {
+        lockHeap(alloc);
+        slabRelease(alloc, page, ptr);
+        unlockHeap(alloc);
+        return;
+    }
+#endif
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    if (threadCacheRelease(block_to_free))
+        return;
+#endif
+#if defined MY_ALLOC_USE_REMOTE_FREE
+    // Blocks of other arenas are handed over without locking
+    if (alloc != selectArena()) {
+        remoteFreePush(alloc, block_to_free);
+        return;
+    }
+#endif
+    lockHeap(alloc);
+    if (!block_to_free->free)
+        releaseBlock(alloc, block_to_free);
+#if defined MY_ALLOC_USE_PURGE && MY_ALLOC_PURGE_DECAY_MS > 0
+    purgeDecay(alloc);
+#endif
+    unlockHeap(alloc);
+}
+
+/**
+ @Function
+ void* myRealloc(void* ptr, size_t size)
+ 
+ @Summary
+ Changes the size of a previous allocated memory.
+ 
+ @Description
+ This function resizes the block in place when possible: a shrinking block releases its tail,
+ a growing block absorbs the following block if it is free. Otherwise a new block is allocated,
+ the content is copied and the old block is released.
+ A NULL ptr behaves as myMalloc, a zero size behaves as myFree.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param ptr Is the pointer to the block to resize.
+ @param size Is the new minimum size of the block.
+ 
+ @Returns
+ Returns the resized block, NULL if the function fails (the original block is left untouched).
+ */
+void* myRealloc(void* ptr, size_t size) {
+    MY_ALLOC* alloc;
+    bool resized;
+    void* rtn;
+    
+    if (ptr == NULL)
+        return myMalloc(size);
+    if (size <= 0) {
+        myFree(ptr);
+        return NULL;
+    }
+    if ((alloc = findArena(ptr)) == NULL)
+        return NULL;
+    
+#if defined MY_ALLOC_USE_SLABS
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page) {
+        // A slot cannot grow, it is moved unless the slot is large enough
+        if (size <= page->slotSize)
+            return ptr;
+        if ((rtn = myMalloc(size)) != NULL) {
+            memcpy(rtn, ptr, page->slotSize);
+            myFree(ptr);
+        }
+        return rtn;
+    }
+#endif
+    lockHeap(alloc);
+    resized = reallocateBlock(alloc, getBlock(ptr), size);
+    unlockHeap(alloc);
+    if (resized)
+        return ptr;
+    
+    // Fallback, move the content to a new block
+    if ((rtn = myMalloc(size)) != NULL) {
+        memcpy(rtn, ptr, size < getBlockContent(getBlock(ptr)) ? size : getBlockContent(getBlock(ptr)));
+        myFree(ptr);
+    }
+    return rtn;
+}
+
+/**
+ @Function
+ void* myCalloc(size_t count, size_t size)
+ 
+ @Summary
+ Returns a pointer to a new zero filled memory block.
+ 
+ @Description
+ This function allocates an array of count elements of size bytes and clears it.
+ Blocks carved from never used heap space are only cleared where the free list node was.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param count Is the number of elements.
+ @param size Is the size of each element.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails or count * size overflows.
+ */
+void* myCalloc(size_t count, size_t size) {
+    void* rtn;
+    
+    // Check the total size does not overflow
+    if (size != 0 && count > ((size_t) -1) / size)
+        return NULL;
+    bool zero;
+    if ((rtn = defaultAllocate(count * size, &zero)) != NULL)
+        clearPayload(rtn, count * size, zero);
+    return rtn;
+}
+
+/**
+ @Function
+ void* myAlignedAlloc(size_t alignment, size_t size)
+ 
+ @Summary
+ Returns a pointer to a new memory block aligned to the given boundary.
+ 
+ @Description
+ This function places the block header so that the payload lands on a multiple of alignment.
+ The leading slack is returned to the free lists. The block is released with myFree.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param alignment Is the alignment of the payload, a power of two.
+ @param size Is the minimum size of the allocated block.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails or alignment is not a power of two.
+ */
+void* myAlignedAlloc(size_t alignment, size_t size) {
+    
+    // Check required space is bigger than zero and alignment is a power of two
+    if (size <= 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return NULL;
+    
+    return arenasAllocate(size, alignment, NULL);
+}
+
+/**
+ @Function
+ MY_ALLOC* MyAlloc_Create(void* region, size_t size, const MY_ALLOC_CONFIG* config)
+ 
+ @Summary
+ Creates a heap instance in the given memory region.
+ 
+ @Description
+ This function places the heap descriptor at the beginning of the region and
+ manages the rest of the region as an independent heap. The region is owned by the
+ instance until MyAlloc_Destroy() is called.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param region Is the first byte of the memory region.
+ @param size Is the region size in bytes.
+ @param config Are the options of the instance, NULL selects a thread-safe instance.
+ 
+ @Returns
+ Returns the heap handle or NULL if the region is too small.
+ */
+MY_ALLOC* MyAlloc_Create(void* region, size_t size, const MY_ALLOC_CONFIG* config) {
+    size_t start = ALIGN((size_t) region);
+    size_t end = ((size_t) region + size) & ~((size_t) ALIGNMENT - 1);
+    MY_ALLOC* heap = (MY_ALLOC*) start;
+    
+    // Sanity check before continue
+    if (region == NULL || (size_t) region + size < (size_t) region)
+        return NULL;
+    start += ALIGN(sizeof(MY_ALLOC)) + METADATA_T_OFFSET;
+    if (end < start)
+        return NULL;
+    end = start + ((end - start) & ~((size_t) ALIGNMENT - 1));
+    if (end - start < METADATA_T_ALIGNED + MIN_PAYLOAD_SIZE)
+        return NULL;
+    
+    arenaInitialization(heap, (void*) start, end - start, config != NULL && config->zeroed);
+    if (config != NULL)
+        heap->threadSafe = config->threadSafe;
+    return heap;
+}
+
+/**
+ @Function
+ void MyAlloc_Destroy(MY_ALLOC* heap)
+ 
+ @Summary
+ Destroys a heap instance.
+ 
+ @Description
+ All the blocks of the instance are released at once and the region is handed back to the caller.
+ The handle allocates nothing afterwards, its functions return NULL.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ */
+void MyAlloc_Destroy(MY_ALLOC* heap) {
+    if (heap == NULL)
+        return;
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+    pthread_mutex_destroy(&heap->lock);
+#endif
+    heap->blocklist = NULL;
+    heap->heapStartAddress = heap->heapEndAddress = 0;
+}
+
+/**
+ @Function
+ void* MyAlloc_MallocFrom(MY_ALLOC* heap, size_t size)
+ 
+ @Summary
+ Returns a pointer to a new memory allocated block of a heap instance.
+ 
+ @Description
+ This function behaves as myMalloc on the given heap instance.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param size Is the minimum size of the allocated block.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails.
+ */
+void* MyAlloc_MallocFrom(MY_ALLOC* heap, size_t size) {
+    void* rtn;
+    
+    // Check required space is bigger than zero, a destroyed heap has no blocks
+    if (heap == NULL || heap->blocklist == NULL || size <= 0)
+        return NULL;
+    
+    lockHeap(heap);
+    rtn = allocateBlock(heap, size, ALIGNMENT);
+    unlockHeap(heap);
+    return rtn;
+}
+
+/**
+ @Function
+ void MyAlloc_FreeTo(MY_ALLOC* heap, void* ptr)
+ 
+ @Summary
+ Release a memory block of a heap instance.
+ 
+ @Description
+ This function behaves as myFree on the given heap instance.
+ Pointers outside the instance are ignored.
+ 
+ @Precondition
+ MyAlloc_MallocFrom must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param ptr Is the pointer to the block to release.
+ */
+void MyAlloc_FreeTo(MY_ALLOC* heap, void* ptr) {
+    
+    // Sanity check before continue
+    if (heap == NULL || ptr == NULL)
+        return;
+    if ((size_t) ptr < heap->heapStartAddress || (size_t) ptr >= heap->heapEndAddress)
+        return;
+    
+    METADATA_T* block_to_free = getBlock(ptr);
+    
+    lockHeap(heap);
+    if (!block_to_free->free)
+        releaseBlock(heap, block_to_free);
+    unlockHeap(heap);
+}
+
+/**
+ @Function
+ void* MyAlloc_ReallocFrom(MY_ALLOC* heap, void* ptr, size_t size)
+ 
+ @Summary
+ Changes the size of a memory block of a heap instance.
+ 
+ @Description
+ This function behaves as myRealloc on the given heap instance.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param ptr Is the pointer to the block to resize.
+ @param size Is the new minimum size of the block.
+ 
+ @Returns
+ Returns the resized block, NULL if the function fails (the original block is left untouched).
+ */
+void* MyAlloc_ReallocFrom(MY_ALLOC* heap, void* ptr, size_t size) {
+    bool resized;
+    void* rtn;
+    
+    if (ptr == NULL)
+        return MyAlloc_MallocFrom(heap, size);
+    if (size <= 0) {
+        MyAlloc_FreeTo(heap, ptr);
+        return NULL;
+    }
+    if (heap == NULL || heap->blocklist == NULL || (size_t) ptr < heap->heapStartAddress || (size_t) ptr >= heap->heapEndAddress)
+        return NULL;
+    
+    lockHeap(heap);
+    resized = reallocateBlock(heap, getBlock(ptr), size);
+    unlockHeap(heap);
+    if (resized)
+        return ptr;
+    
+    // Fallback, move the content to a new block
+    if ((rtn = MyAlloc_MallocFrom(heap, size)) != NULL) {
+        memcpy(rtn, ptr, size < getBlockRequest(getBlock(ptr)) ? size : getBlockRequest(getBlock(ptr)));
+        MyAlloc_FreeTo(heap, ptr);
+    }
+    return rtn;
+}
+
+/**
+ @Function
+ void* MyAlloc_CallocFrom(MY_ALLOC* heap, size_t count, size_t size)
+ 
+ @Summary
+ Allocates a zero filled memory block from a heap instance.
+ 
+ @Description
+ This function behaves as myCalloc on the given heap instance.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param count Is the number of elements.
+ @param size Is the size of each element.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails or count * size overflows.
+ */
+void* MyAlloc_CallocFrom(MY_ALLOC* heap, size_t count, size_t size) {
+    void* rtn;
+    
+    // Check the total size does not overflow
+    if (size != 0 && count > ((size_t) -1) / size)
+        return NULL;
+    if (heap == NULL || heap->blocklist == NULL || count * size <= 0)
+        return NULL;
+    
+    lockHeap(heap);
+    rtn = allocateBlock(heap, count * size, ALIGNMENT);
+    bool zero = rtn != NULL && consumeZero(rtn);
+    unlockHeap(heap);
+    if (rtn != NULL)
+        clearPayload(rtn, count * size, zero);
+    return rtn;
+}
+
+/**
+ @Function
+ void* MyAlloc_AlignedAllocFrom(MY_ALLOC* heap, size_t alignment, size_t size)
+ 
+ @Summary
+ Allocates an aligned memory block from a heap instance.
+ 
+ @Description
+ This function behaves as myAlignedAlloc on the given heap instance.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param alignment Is the alignment of the payload, a power of two.
+ @param size Is the minimum size of the allocated block.
+ 
+ @Returns
+ Returns a not NULL pointer if the funciont successes.
+ Returns a NULL pointer if the function fails or alignment is not a power of two.
+ */
+void* MyAlloc_AlignedAllocFrom(MY_ALLOC* heap, size_t alignment, size_t size) {
+    void* rtn;
+    
+    // Check required space is bigger than zero and alignment is a power of two
+    if (heap == NULL || heap->blocklist == NULL || size <= 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return NULL;
+    
+    lockHeap(heap);
+    rtn = allocateBlock(heap, size, alignment);
+    unlockHeap(heap);
+    return rtn;
+}
+
 /**
  @Function
- void myMalloc_Initialization (void)
+ void MyAlloc_GetRequestedSize(void* ptr)
  
  @Summary
- Initialization function used to prepare the linked list.
+ Return the size of the requested memory.
  
  @Description
- This function assigns the linked list to the new heap area
- and initialize the head of the linked list.
+ This function returns the size of the requested memory.
  
  @Precondition
- None.
+ MyMalloc must be called and returns successully.
  
  @Parameters
- None.
+ A valid pointer to the beginning of the heap section
  
- @Remarks
- To use this functions you must declare the start heap address.
- Use #define HEAP_START_ADDRESS to specify a physical address.
  */
-static void myMalloc_Initialization(void) {
-    // Assign the head of the linked list to the destination heap
-    myAlloc.heapStartAddress = (size_t)(&heap);
-    myAlloc.heapEndAddress = (size_t)(&heap) + ALIGN(MAX_HEAP_SIZE);
-    myAlloc.heapSize = ALIGN(MAX_HEAP_SIZE);
-    myAlloc.requests = 0;
-    myAlloc.blocklist = (METADATA_T*) heap;
-    // Initialize chain fields
-    myAlloc.blocklist->next = NULL;
-    myAlloc.blocklist->prev = NULL;
-    myAlloc.blocklist->size = 0;
-    myAlloc.blocklist->free = true; // Define the initial memory status, all free
+size_t MyAlloc_GetRequestedSize(void* ptr) {
+    // Sanity check before continue
+    if (ptr == NULL)
+        return 0;
     
-    // Debug info
-#ifdef MY_ALLOC_PRINT_DEBUG_INFO
-    printf("Heap start address: %p 0x%lX\r\n", myAlloc.blocklist, myAlloc.heapStartAddress);
-    printf("Heap end address: 0x%lX\r\n", myAlloc.heapEndAddress);
-    printf("Heap size: %lu bytes\r\n", myAlloc.heapSize);
+    // Find associated METADATA_T block
+    METADATA_T* block = getBlock(ptr);
     
-    printf("Heap header size: %lu bytes\r\n", sizeof(METADATA_T));
+#if defined MY_ALLOC_USE_SLABS
+    // Slots only know their size
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page)
+        return page->slotSize;
 #endif
+    return getBlockContent(block);
 }
 
 /**
  @Function
- static size_t getBlockSize(METADATA_T* block).
+ size_t MyAlloc_GetUsableSize(void* ptr)
  
  @Summary
- Returns the block size.
+ Return the number of bytes that can be used in a block of the default heap.
  
  @Description
- This function calculates and returns the block size.
- The length is in bytes.
+ The usable size covers the requested size plus the rounding and the tail too small to be split.
  
  @Precondition
- myMalloc_Initialization() must be called.
+ None.
  
  @Parameters
- @param block Is the referred block which length is calculated.
+ @param ptr Is a pointer returned by myMalloc, myCalloc, myRealloc or myAlignedAlloc.
  
  @Returns
- Return the length in bytes of the given block.
+ Returns the usable size in bytes or 0 if ptr does not belong to the default heap.
  */
-static size_t getBlockSize(METADATA_T* block) {
+size_t MyAlloc_GetUsableSize(void* ptr) {
+    MY_ALLOC* alloc;
     size_t size;
     
-    if (block->next == NULL) {
-        // No more blocks after this in the chain
-        if (block->prev == NULL)
-            size = myAlloc.heapSize - METADATA_T_ALIGNED; // Head (only) block
-        else
-            size = ((size_t)(myAlloc.heapEndAddress) - (size_t) (block)) - METADATA_T_ALIGNED;
-    } else {
-        // More blocks after this
-        size = ((size_t) (block->next) - (size_t) (block)) - METADATA_T_ALIGNED;
-    }
+    if (ptr == NULL || (alloc = findArena(ptr)) == NULL)
+        return 0;
+#if defined MY_ALLOC_USE_SLABS
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page)
+        return page->slotSize;
+#endif
+    lockHeap(alloc);
+    size = getBlockSize(alloc, getBlock(ptr));
+    unlockHeap(alloc);
     return size;
 }
 
-#if defined USE_FIRST_FIT
-static METADATA_T* algorithmFirstFit(METADATA_T* current, size_t length) {
-    // First-fit implementation. Start from the first block
-    // Increment block until we find one that is free and large enough to fit numbytes
-    while (current && !(current->free && getBlockSize(current) >= length))
-        current = current->next;
-    return current;
-}
-#elif defined USE_BEST_FIT
-static METADATA_T* algorithmBestFit(METADATA_T* current, size_t length) {
-    // Best-fit implementation. Find the smallest block by inspecting the size of all blocks
-    METADATA_T* smallest = NULL;
-    size_t block_size, size = myAlloc.heapSize;
-    while (current) {
-        if (current->free) {
-            block_size = getBlockSize(current);
-            if (block_size >= length && block_size < size) {
-                size = block_size;
-                smallest = current;
-            }
-        }
-        current = current->next;
-    }
-    return smallest;
+/**
+ @Function
+ bool MyAlloc_GetArenaStats(unsigned int arena, MY_ALLOC_ARENA_STATS* stats)
+ 
+ @Summary
+ Return the occupancy of an arena.
+ 
+ @Description
+ This function fills stats with the address range, the used and free bytes (headers included)
+ and the number of live allocations of the given arena.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param arena Is the arena index, from 0 to MY_ALLOC_ARENAS - 1.
+ @param stats Is the structure to fill.
+ 
+ @Returns
+ Returns false if the arena does not exist.
+ */
+bool MyAlloc_GetArenaStats(unsigned int arena, MY_ALLOC_ARENA_STATS* stats) {
+    if (arena >= MY_ALLOC_ARENAS)
+        return false;
+    checkInitialization();
+    return MyAlloc_GetHeapStats(&arenas[arena], stats);
 }
-#endif
-
-/* ************************************************************************** */
-/* ************************************************************************** */
-// Section: Public Functions                                                  */
-/* ************************************************************************** */
-/* ************************************************************************** */
 
+/**
+ @Function
+ bool MyAlloc_GetHeapStats(MY_ALLOC* heap, MY_ALLOC_ARENA_STATS* stats)
+ 
+ @Summary
+ Return the occupancy of a heap instance or of an arena of the default heap.
+ 
+ @Precondition
+ MyAlloc_Create must be called and returns successully.
+ 
+ @Parameters
+ @param heap Is the heap handle.
+ @param stats Is the structure to fill.
+ 
+ @Returns
+ Returns false if the parameters are not valid.
+ */
+bool MyAlloc_GetHeapStats(MY_ALLOC* heap, MY_ALLOC_ARENA_STATS* stats) {
+    if (heap == NULL || heap->blocklist == NULL || stats == NULL)
+        return false;
+    
+    lockHeap(heap);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+    remoteFreeDrain(heap);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+    slabTrim(heap); // Spare pages are accounted as free
+#endif
+    stats->heapStartAddress = heap->heapStartAddress;
+    stats->heapSize = heap->heapSize;
+    stats->usedSize = heap->usedSize;
+    stats->freeSize = heap->heapSize - heap->usedSize;
+    stats->largestFree = heap->largestFree;
+#if defined MY_ALLOC_USE_MMAP
+    stats->committedSize = heap->committedEnd > heap->heapStartAddress ? heap->committedEnd - heap->heapStartAddress : 0;
+#else
+    stats->committedSize = heap->heapSize;
+#endif
+    stats->requests = heap->requests;
+    unlockHeap(heap);
+    return true;
+}
 
 /**
  @Function
- void* myMalloc(size_t size)
+ size_t MyAlloc_GetLargestFree(void)
  
  @Summary
- Returns a pointer to a new memory allocated block.
+ Returns the payload size of the largest free block of the default heap.
  
  @Description
- This function returns a void pointer to a new memory allocated block of size size.
+ Each arena keeps the size of its largest free block while blocks enter and leave its free lists,
+ the value is read without taking the locks. A request larger than it fails unless blocks are released first.
+ Blocks cached by threads, slab slots and blocks waiting in a remote free list are not free blocks.
  
  @Precondition
  None.
  
  @Parameters
- @param size Is the minimum size of the allocated block.
+ None.
  
  @Returns
- Returns a not NULL pointer if the funciont successes.
- Returns a NULL pointer if the function fails.
+ Returns the size in bytes of the largest free block, 0 if there is none.
  */
-void* myMalloc(size_t size) {
-    
-    size_t length;
-    METADATA_T* current;
+size_t MyAlloc_GetLargestFree(void) {
+    size_t size, largest = 0;
+    unsigned int i;
     
-    // Initialize pointer chain
-    if (myAlloc.blocklist == NULL)
-        myMalloc_Initialization();
-    
-    // Check required space is bigger than zero
-    if (size <= 0)
-        return NULL;
-    
-    // Round up requested bytes to be compatible with word processor allignment
-    // This is not used for cache lines boundaries (see padding bytes instead)
-    length = ALIGN(size);
-    
-    // Free space research algorithm
-#if defined USE_FIRST_FIT
-    current = algorithmFirstFit(myAlloc.blocklist, length);
-#elif defined USE_BEST_FIT
-    current = algorithmBestFit(myAlloc.blocklist, length);
-#endif
-    
-    // Check that current is a valid METADATA_T* pointer, space may be over
-    if (current == NULL)
-        return NULL;
-    
-    // Block found. Mark it as allocated
-    current->free = false;
-    current->size = (uint32_t)size;
-    
-    // Check if block size is large enough to split
-    if (getBlockSize(current) >= (length + METADATA_T_ALIGNED)) {
-        // Create a new free block in current's extra space
-        METADATA_T* newblock = (METADATA_T*) (((char*) (current)) + length + METADATA_T_ALIGNED);
-        newblock->free = true;
-        newblock->prev = current;
-        newblock->next = current->next;
-        if (newblock->next)
-            newblock->next->prev = newblock;
-        // Refine current block's data
-        current->next = newblock;
-    }
-    
-    // Return a pointer to the beginning of the newly allocated block
-    void *rtn = (void*) ((METADATA_T*) (((char*) (current)) + METADATA_T_ALIGNED));
-    myAlloc.requests += 1;
-    
-    return rtn;
+    checkInitialization();
+    for (i = 0; i < MY_ALLOC_ARENAS; i++)
+        if ((size = __atomic_load_n(&arenas[i].largestFree, __ATOMIC_RELAXED)) > largest)
+            largest = size;
+    return largest;
 }
 
 /**
  @Function
- void myFree(void* ptr)
+ double MyAlloc_GetFragmentation(void)
  
  @Summary
- Release a previous allocated memory.
+ Returns the external fragmentation of the default heap.
  
  @Description
- This function releases a previous allocated piece of dynamic memory.
+ The index is 1 - largest free block / free bytes, both counted as payload bytes of the blocks in the free lists.
+ It is 0 when the free space is a single block and approaches 1 when it is scattered in many small blocks.
+ The totals are read without taking the locks, like MyAlloc_GetLargestFree().
  
  @Precondition
- MyMalloc must be called and returns successully.
+ None.
  
  @Parameters
- @param ptr Is the pointer to the block to release.
+ None.
  
+ @Returns
+ Returns the index between 0 and 1, 0 if there is no free block.
  */
-void myFree(void* ptr) {
-    
-    // Sanity check before continue
-    if (ptr == NULL)
-        return;
-    
-    // Find the block that we want to free from the pointer parameter (pointer math)
-    METADATA_T* block_to_free = ((METADATA_T*) ptr) - 1;
-    
-    // Return if invalid block
-    if (block_to_free == NULL) {
-        //printf("Error block at %p not found\n", ptr);
-        return;
-    }
-    
-    // Free current block
-    block_to_free->free = true;
-    block_to_free->size = 0;
+double MyAlloc_GetFragmentation(void) {
+    size_t size, largest = 0, total = 0;
+    unsigned int i;
     
-    // Coalesce after each free
-    METADATA_T* previous_block = block_to_free->prev;
-    METADATA_T* next_block = block_to_free->next;
-    
-    if (previous_block && previous_block->free) {
-        // Combine previous, current, and next blocks
-        if (next_block && next_block->free) {
-            // Combine previous and next block
-            previous_block->next = next_block->next;
-            if (next_block->next)
-                next_block->next->prev = previous_block;
-        } else {
-            // Combine previous and current blocks
-            previous_block->next = next_block;
-            if (next_block)
-                next_block->prev = previous_block;
-        }
-    } else if (next_block && next_block->free) {
-        // Combine current and next blocks
-        block_to_free->next = next_block->next;
-        if (next_block->next)
-            next_block->next->prev = block_to_free;
+    checkInitialization();
+    for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+        total += __atomic_load_n(&arenas[i].freeBytes, __ATOMIC_RELAXED);
+        if ((size = __atomic_load_n(&arenas[i].largestFree, __ATOMIC_RELAXED)) > largest)
+            largest = size;
     }
-    myAlloc.requests -= 1;
+    // The two totals are read one after the other, a concurrent change must not make the index negative
+    if (total == 0 || largest >= total)
+        return 0.0;
+    return 1.0 - (double) largest / (double) total;
 }
 
+#if defined MY_ALLOC_USE_THREAD_CACHE
 /**
  @Function
- void MyAlloc_GetRequestedSize(void* ptr)
+ void MyAlloc_FlushThreadCache(void)
  
  @Summary
- Return the size of the requested memory.
+ Returns all the blocks cached by the calling thread to the heap.
  
  @Description
- This function returns the size of the requested memory.
+ The cache of a thread is flushed automatically when the thread exits.
+ Call this function to release the cached memory earlier, e.g. before a long idle period.
  
  @Precondition
- MyMalloc must be called and returns successully.
+ None.
  
  @Parameters
- A valid pointer to the beginning of the heap section
+ None.
  
  */
-size_t MyAlloc_GetRequestedSize(void* ptr) {
-    // Sanity check before continue
-    if (ptr == NULL)
-        return 0;
-    
-    // Find associated METADATA_T block
-    METADATA_T* block = ((METADATA_T*) ptr) - 1;
-    
-    return block->size;
+void MyAlloc_FlushThreadCache(void) {
+    threadCacheDestructor(&threadCache);
 }
+#endif
 
-#ifdef MY_ALLOC_PRINT_DEBUG_INFO
+#if defined MY_ALLOC_USE_PURGE
 /**
  @Function
- void MyAlloc_PrintFreelist(void)
+ size_t MyAlloc_Purge(void)
  
  @Summary
- Print a summary of the heap status.
+ Returns the unused pages of the default heap to the system.
  
  @Description
- This function is available in debug mode to print a summary of the dynamic memory allocation.
+ The whole pages of the free blocks of every arena are released, the resident memory shrinks
+ while the heap keeps its size. A released page costs a page fault the first time it is used again,
+ blocks already purged and not used since are skipped. Blocks cached by threads are not released.
  
  @Precondition
- MyMalloc must be called and returns successully.
+ None.
  
  @Parameters
  None.
  
+ @Returns
+ Returns the number of bytes released.
  */
-void MyAlloc_PrintFreelist(void) {
+size_t MyAlloc_Purge(void) {
+    size_t purged = 0;
+    unsigned int i;
+    
+    checkInitialization();
+    for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+        lockHeap(&arenas[i]);
+        purged += arenaPurge(&arenas[i]);
+        unlockHeap(&arenas[i]);
+    }
+    return purged;
+}
+#endif
+
+#if defined MY_ALLOC_USE_STATS
+/**
+ @Function
+ bool MyAlloc_GetStats(MY_ALLOC_STATS* stats)
+ 
+ @Summary
+ Reads the counters of the default heap.
+ 
+ @Description
+ The sizes, the peak and the block count are kept by each arena under its lock, the reading takes each lock once.
+ The events are counted by each thread, the counters of the running threads and of the exited ones are summed.
+ No chain is walked, the cost does not depend on the number of blocks.
+ Slab pages are used blocks, blocks cached by threads or waiting in a remote free list are used too.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param stats Is the structure to fill.
+ 
+ @Returns
+ Returns false if stats is NULL.
+ */
+bool MyAlloc_GetStats(MY_ALLOC_STATS* stats) {
+    THREAD_STATS_T events;
+    unsigned int i;
+    
+    if (stats == NULL)
+        return false;
+    checkInitialization();
+    memset(stats, 0, sizeof(MY_ALLOC_STATS));
+    for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+        lockHeap(&arenas[i]);
+        stats->usedSize += arenas[i].usedSize;
+        stats->freeSize += arenas[i].heapSize - arenas[i].usedSize;
+        stats->peakSize += arenas[i].peakSize;
+        stats->blocks += arenas[i].blocks;
+        unlockHeap(&arenas[i]);
+    }
+    
+    memset(&events, 0, sizeof(THREAD_STATS_T));
+#if defined MY_ALLOC_STATS_PER_THREAD
+    THREAD_STATS_T* local;
+    lockAcquire(&statsLock);
+    statsFold(&events, &statsRetired);
+    for (local = statsThreads; local != NULL; local = local->next)
+        statsFold(&events, local);
+    lockRelease(&statsLock);
+#else
+    statsFold(&events, &threadStats);
+#endif
+    memcpy(stats->allocs, events.allocs, sizeof(stats->allocs));
+    memcpy(stats->frees, events.frees, sizeof(stats->frees));
+    stats->splits = events.splits;
+    stats->coalesces = events.coalesces;
+    stats->failures = events.failures;
+    return true;
+}
+#endif
+
+#ifdef MY_ALLOC_PRINT_DEBUG_INFO
+// Print the block chain of one arena, the arena lock must be held
+static void printArena(MY_ALLOC* alloc) {
     long totalRequired = 0, totalAssigned = 0, totalTotal = 0;
-    METADATA_T *blocklist_head = myAlloc.blocklist;
+    METADATA_T *blocklist_head = alloc->blocklist;
     
     int i = 0;
     printf("   |                  Blocks addresses                 |        |                Space                 \r\n");
     printf(" # |   Prev block   |     Current     |   Next block   | Status |  Required  |  Assigned  |   Total    \r\n");
     printf("---+----------------+-----------------+----------------+--------+------------+------------+------------\r\n");
     while (blocklist_head != NULL) {
-        size_t space = getBlockSize(blocklist_head);
-        size_t total;
-        if ((char*) (blocklist_head->next) > (char*) (blocklist_head))
-            total = ((char*) (blocklist_head->next) - (char*) (blocklist_head));
-        else
-            total = ((size_t)(myAlloc.blocklist) - (size_t)(blocklist_head)) + myAlloc.heapSize ;
+        size_t space = getBlockSize(alloc, blocklist_head);
+        size_t total = getBlockSize(alloc, blocklist_head) + METADATA_T_ALIGNED;
         
-        printf("%2d | %14p | %15p | %14p |  %s  | %10d | %10lu | %10lu\r\n", i++, blocklist_head->prev,
-               blocklist_head, blocklist_head->next,
-               blocklist_head->free ? "free" : "used", blocklist_head->size,space,  total);
-        totalRequired +=blocklist_head->size;
+        printf("%2d | %14p | %15p | %14p |  %s  | %10lu | %10lu | %10lu\r\n", i++, getPrevBlock(blocklist_head),
+               blocklist_head, getNextBlock(blocklist_head),
+               blocklist_head->free ? "free" : "used", blocklist_head->free ? 0 : getBlockRequest(blocklist_head), space,  total);
+        totalRequired += blocklist_head->free ? 0 : getBlockRequest(blocklist_head);
         if (blocklist_head->free == false)
             totalAssigned += space;
         totalTotal += total;
-        blocklist_head = blocklist_head->next;
+        blocklist_head = getNextBlock(blocklist_head);
     }
     printf("---+----------------+-----------------+----------------+--------+------------+------------+------------\r\n");
     printf("   |                |                 |                |        | %10ld | %10lu | %10lu\r\n", totalRequired, totalAssigned, totalTotal);
@@ -368,43 +3107,108 @@ void MyAlloc_PrintFreelist(void) {
     printf("\r\n");
 }
 
+// Sum the total size of the free (or used) blocks of one arena, the arena lock must be held
+static size_t getArenaSpace(MY_ALLOC* alloc, bool free) {
+    METADATA_T *blocklist_head = alloc->blocklist;
+    size_t totalSpace = 0;
+    
+    while (blocklist_head != NULL) {
+        size_t total = getBlockSize(alloc, blocklist_head) + METADATA_T_ALIGNED;
+        if (blocklist_head->free == free)
+            totalSpace += total;
+        blocklist_head = getNextBlock(blocklist_head);
+    }
+    return totalSpace;
+}
+
+/**
+ @Function
+ void MyAlloc_PrintFreelist(void)
+ 
+ @Summary
+ Print a summary of the heap status.
+ 
+ @Description
+ This function is available in debug mode to print a summary of the dynamic memory allocation.
+ With more than one arena, a table is printed for each arena.
+ 
+ @Precondition
+ MyMalloc must be called and returns successully.
+ 
+ @Parameters
+ None.
+ 
+ */
+void MyAlloc_PrintFreelist(void) {
+    unsigned int arena;
+    
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    MyAlloc_FlushThreadCache(); // Cached blocks are accounted as free
+#endif
+    checkInitialization();
+    for (arena = 0; arena < MY_ALLOC_ARENAS; arena++) {
+#if MY_ALLOC_ARENAS > 1
+        printf("Arena %u\r\n", arena);
+#endif
+        lockHeap(&arenas[arena]);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        remoteFreeDrain(&arenas[arena]);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+        slabTrim(&arenas[arena]);
+#endif
+        printArena(&arenas[arena]);
+        unlockHeap(&arenas[arena]);
+    }
+}
+
 size_t MyAlloc_GetFreeNonLinearSpace(void) {
-    METADATA_T *blocklist_head = myAlloc.blocklist;
     size_t totalFree = 0;
+    unsigned int arena;
     
-    while (blocklist_head != NULL) {
-        size_t total;
-        if ((char*) (blocklist_head->next) > (char*) (blocklist_head))
-            total = ((char*) (blocklist_head->next) - (char*) (blocklist_head));
-        else
-            total = ((size_t)(myAlloc.blocklist) - (size_t)(blocklist_head)) + myAlloc.heapSize ;
-        if (blocklist_head->free)
-            totalFree += total;
-        blocklist_head = blocklist_head->next;
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    MyAlloc_FlushThreadCache(); // Cached blocks are accounted as free
+#endif
+    checkInitialization();
+    for (arena = 0; arena < MY_ALLOC_ARENAS; arena++) {
+        lockHeap(&arenas[arena]);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        remoteFreeDrain(&arenas[arena]);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+        slabTrim(&arenas[arena]);
+#endif
+        totalFree += getArenaSpace(&arenas[arena], true);
+        unlockHeap(&arenas[arena]);
     }
     return totalFree;
 }
 
 
 size_t MyAlloc_GetFullNonLinearSpace(void) {
-    METADATA_T *blocklist_head = myAlloc.blocklist;
-    size_t totalFree = 0;
+    size_t totalFull = 0;
+    unsigned int arena;
     
-    while (blocklist_head != NULL) {
-        size_t total;
-        if ((char*) (blocklist_head->next) > (char*) (blocklist_head))
-            total = ((char*) (blocklist_head->next) - (char*) (blocklist_head));
-        else
-            total = ((size_t)(myAlloc.blocklist) - (size_t)(blocklist_head)) + myAlloc.heapSize ;
-        if (!blocklist_head->free)
-            totalFree += total;
-        blocklist_head = blocklist_head->next;
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    MyAlloc_FlushThreadCache(); // Cached blocks are accounted as free
+#endif
+    checkInitialization();
+    for (arena = 0; arena < MY_ALLOC_ARENAS; arena++) {
+        lockHeap(&arenas[arena]);
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        remoteFreeDrain(&arenas[arena]);
+#endif
+#if defined MY_ALLOC_USE_SLABS
+        slabTrim(&arenas[arena]);
+#endif
+        totalFull += getArenaSpace(&arenas[arena], false);
+        unlockHeap(&arenas[arena]);
     }
-    return totalFree;
+    return totalFull;
 }
 
 size_t MyAlloc_GetAssignedSize(void* ptr) {
-    return ALIGN(MyAlloc_GetRequestedSize(ptr));
+    return getRequestLength(MyAlloc_GetRequestedSize(ptr));
 }
 
 size_t MyAlloc_GetTotalSize(void* ptr) {
@@ -413,7 +3217,20 @@ size_t MyAlloc_GetTotalSize(void* ptr) {
         return 0;
     
     // Find associated METADATA_T block
-    METADATA_T* block = ((METADATA_T*) ptr) - 1;
-    return getBlockSize(block) + sizeof(METADATA_T);
+    METADATA_T* block = getBlock(ptr);
+    MY_ALLOC* alloc = findArena(ptr);
+    size_t size;
+    
+    if (alloc == NULL)
+        return 0;
+#if defined MY_ALLOC_USE_SLABS
+    SLAB_PAGE_T* page = slabFind(ptr);
+    if (page)
+        return page->slotSize;
+#endif
+    lockHeap(alloc);
+    size = getBlockSize(alloc, block) + METADATA_T_ALIGNED;
+    unlockHeap(alloc);
+    return size;
 }
 #endif
@@ -13,7 +13,7 @@
  
  @Description
  This file is the header of a custom memory allocator designed for low-end MCUs.
- In the header file the user can select between two allocation strategies USE_FISRT_FIT and USE_BEST_FIT.
+ In the header file the user can select between four allocation strategies USE_FISRT_FIT, USE_BEST_FIT, USE_TLSF and USE_BUDDY.
  Moreover CACHE_LINE_SIZE enables a padding before the structure allocation to prevent cache memory allignment invalidation.
  
  @License
@@ -64,32 +64,199 @@ extern "C" {
      * These constants should be manually define before use this functions.
      */
     
+    // Production builds, e.g. the preload library, define MY_ALLOC_NO_DEBUG_INFO
+#if !defined MY_ALLOC_NO_DEBUG_INFO
 #define MY_ALLOC_PRINT_DEBUG_INFO // Do not use in production phase
+#endif
+    
+    // The default heap is reserved with mmap() instead of being a static array (POSIX only)
+    // Pages are committed with mprotect() as the heap grows, untouched memory costs neither RSS nor commit charge
+    // DDR_SIZE is then the default size of the reservation, the MYALLOC_HEAP_SIZE environment variable overrides it
+    //#define MY_ALLOC_USE_MMAP
+#define MY_ALLOC_HEAP_SIZE_ENV      "MYALLOC_HEAP_SIZE"
+#if defined MY_ALLOC_USE_MMAP && !defined __unix__ && !defined __APPLE__
+#error "The mmap-backed heap requires a POSIX system."
+#endif
+    
+    // Default heap aligned to huge pages and advised with madvise(MADV_HUGEPAGE), fewer TLB misses on large heaps (Linux only)
+    // MY_ALLOC_USE_HUGETLB first maps the mmap-backed heap with MAP_HUGETLB, from the pool of reserved huge pages,
+    // and falls back to transparent huge pages when the pool cannot hold the heap
+    //#define MY_ALLOC_USE_HUGE_PAGES
+    //#define MY_ALLOC_USE_HUGETLB
+#define MY_ALLOC_HUGE_PAGE_SIZE     (2 * 1024 * 1024)
+#if defined MY_ALLOC_USE_HUGE_PAGES && !defined __linux__
+#error "Huge pages are requested with madvise(MADV_HUGEPAGE), it requires Linux."
+#endif
+#if defined MY_ALLOC_USE_HUGETLB && (!defined MY_ALLOC_USE_HUGE_PAGES || !defined MY_ALLOC_USE_MMAP)
+#error "MY_ALLOC_USE_HUGETLB requires MY_ALLOC_USE_HUGE_PAGES and MY_ALLOC_USE_MMAP."
+#endif
     
+    // Multiple of the page size, the committed part of an mmap-backed arena grows by at least this amount
+#if !defined MY_ALLOC_MMAP_COMMIT_STEP
+#if defined MY_ALLOC_USE_HUGE_PAGES
+#define MY_ALLOC_MMAP_COMMIT_STEP   MY_ALLOC_HUGE_PAGE_SIZE // Whole huge pages
+#else
+#define MY_ALLOC_MMAP_COMMIT_STEP   65536
+#endif
+#endif
+    
+#if !defined DDR_SIZE
+#if defined MY_ALLOC_USE_MMAP
+#define DDR_SIZE                (1024UL * 1024 * 1024) // Only address space, the 32-bit headers limit an arena to 1 GByte
+#else
 #define DDR_SIZE                1024 * 1
+#endif
     //#define DDR_SIZE                32 * 1024 * 1024 // PIC32 DA has 32 MBytes
+#endif
     
     
 #define MAX_HEAP_SIZE           DDR_SIZE
     ///#define HEAP_START_ADDRESS      (0xA8000000) // PIC32 DA
     
     
-    // On 32-bit machines 4 bytes are typical. 8 bytes are used on 64-bit, instead
+    // Block header layout, selected by the pointer width unless the build forces one
+    // The 64-bit layout stores size_t-wide sizes, the compact 32-bit layout limits blocks to 1 GByte for MCU builds
+    //#define MY_ALLOC_HEADER_32
+    //#define MY_ALLOC_HEADER_64
+#if !defined MY_ALLOC_HEADER_32 && !defined MY_ALLOC_HEADER_64
+#if UINTPTR_MAX > 0xFFFFFFFF
+#define MY_ALLOC_HEADER_64
+#else
+#define MY_ALLOC_HEADER_32
+#endif
+#endif
+#if defined MY_ALLOC_HEADER_32 && defined MY_ALLOC_HEADER_64
+#error "Only one header layout at time can be choosen."
+#endif
+    
+#if defined MY_ALLOC_HEADER_64
+    // On 64-bit machines 8 bytes words, payloads are aligned as malloc does on x86-64 and AArch64
+#define WORD_SIZE               8
+#define ALIGNMENT               (2 * WORD_SIZE)
+#define BLOCK_SIZE_BITS         62
+    typedef uint64_t BLOCK_SIZE_T;
+#else
+    // On 32-bit machines 4 bytes are typical
 #define WORD_SIZE               4
     
     // single word (4) or double word (8) alignment
 #define ALIGNMENT               WORD_SIZE   /* typically, single word on 32-bit systems and double word on 64-bit systems */
+#define BLOCK_SIZE_BITS         30
+    typedef uint32_t BLOCK_SIZE_T;
+#endif
+    
+    // Compact 8 bytes header, blocks are linked through 32-bit distances instead of pointers
+    // Boundary tags, one word header and a footer on free blocks only, used blocks carry one word of overhead
+    // With both layouts the requested size is not stored (MyAlloc_GetRequestedSize returns the usable size)
+    //#define MY_ALLOC_COMPACT_HEADER
+    //#define MY_ALLOC_BOUNDARY_TAGS
+#if defined MY_ALLOC_COMPACT_HEADER && defined MY_ALLOC_BOUNDARY_TAGS
+#error "Only one header layout at time can be choosen."
+#endif
+#if defined MY_ALLOC_COMPACT_HEADER || defined MY_ALLOC_BOUNDARY_TAGS
+#define MY_ALLOC_RELATIVE_HEADER
+#endif
     
     // rounds up to the nearest multiple of ALIGNMENT
 #define ALIGN(size)             (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
+    // Compact and boundary tag headers are not padded, the first header of an arena starts METADATA_T_OFFSET bytes late
+    // so that header and payload pairs keep every payload aligned
+#if defined MY_ALLOC_RELATIVE_HEADER
+#define METADATA_T_ALIGNED      (sizeof(METADATA_T))
+#else
 #define METADATA_T_ALIGNED      (ALIGN(sizeof(METADATA_T)))
+#endif
+#define METADATA_T_OFFSET       (ALIGN(sizeof(METADATA_T)) - METADATA_T_ALIGNED)
     
+    // Best-fit is used unless the build selects another algorithm
     //#define USE_FIRST_FIT
+    //#define USE_TLSF            // Two-level segregated fit, O(1) malloc and free
+    //#define USE_BUDDY           // Binary buddy system, power-of-two blocks merged with their buddy only
+#if !defined USE_FIRST_FIT && !defined USE_TLSF && !defined USE_BUDDY
 #define USE_BEST_FIT
-#if defined USE_FIRST_FIT && defined USE_BEST_FIT
+#endif
+#if (defined USE_FIRST_FIT + defined USE_BEST_FIT + defined USE_TLSF + defined USE_BUDDY) > 1
 #error "Only one algorithm at time can be choosen."
 #endif
     
+    // Free blocks indexed by a balanced (AVL) tree ordered by size and address instead of the segregated lists
+    // Best-fit finds the tightest block and first-fit the lowest fitting address in logarithmic time
+    //#define MY_ALLOC_USE_FREE_TREE
+#if defined MY_ALLOC_USE_FREE_TREE && (defined USE_TLSF || defined USE_BUDDY)
+#error "The free tree replaces the segregated lists, it requires USE_BEST_FIT or USE_FIRST_FIT."
+#endif
+#if defined MY_ALLOC_USE_MMAP && defined USE_BUDDY
+#error "The buddy system carves the whole arena at initialization, it cannot grow an mmap-backed heap."
+#endif
+    
+    // Lock policy used to share the heap among threads
+#define MY_ALLOC_LOCK_NONE          0   // Single thread, no synchronization
+#define MY_ALLOC_LOCK_PTHREAD       1   // POSIX mutex
+#define MY_ALLOC_LOCK_SPINLOCK      2   // Test-and-set spinlock with exponential backoff
+#define MY_ALLOC_LOCK_USER          3   // Application defined MyAlloc_EnterCritical() and MyAlloc_ExitCritical()
+#if !defined MY_ALLOC_LOCK
+#if defined __unix__ || defined __APPLE__
+#define MY_ALLOC_LOCK               MY_ALLOC_LOCK_PTHREAD
+#else
+#define MY_ALLOC_LOCK               MY_ALLOC_LOCK_NONE
+#endif
+#endif
+    // Upper bound of the busy-wait rounds between two attempts to take the spinlock
+#define MY_ALLOC_SPIN_BACKOFF_MAX   1024
+    
+    // The heap is split in MY_ALLOC_ARENAS independently locked arenas of equal size
+    // Threads are assigned round-robin or, with MY_ALLOC_ARENA_BY_CPU, by the CPU they run on (Linux only)
+#if !defined MY_ALLOC_ARENAS
+#define MY_ALLOC_ARENAS             1
+#endif
+    //#define MY_ALLOC_ARENA_BY_CPU
+#if MY_ALLOC_ARENAS > 1 && MY_ALLOC_LOCK == MY_ALLOC_LOCK_USER
+#error "Arenas require a lock for each arena, MY_ALLOC_LOCK_USER provides a single critical section."
+#endif
+    
+    // Each arena is owned by the threads assigned to it. A thread that frees a block of another arena
+    // pushes it with a CAS on the remote free list of that arena instead of taking its lock.
+    // The arena drains the list in a single batch the next time it allocates.
+    //#define MY_ALLOC_USE_REMOTE_FREE
+#if defined MY_ALLOC_USE_REMOTE_FREE && MY_ALLOC_ARENAS == 1
+#error "Remote frees require more than one arena."
+#endif
+    
+    // Per-thread cache of small freed blocks in front of the shared heap
+    // A malloc/free pair of a cached size does not take the heap lock
+    //#define MY_ALLOC_USE_THREAD_CACHE
+#define THREAD_CACHE_MAX_SIZE       256 // Largest payload kept in the cache
+#define THREAD_CACHE_CLASSES        (THREAD_CACHE_MAX_SIZE / ALIGNMENT + 1)
+#define THREAD_CACHE_DEPTH          32  // Blocks kept for each size
+#define THREAD_CACHE_BATCH          16  // Blocks returned to the heap at once when a size overflows
+#if defined MY_ALLOC_USE_THREAD_CACHE && MY_ALLOC_LOCK != MY_ALLOC_LOCK_PTHREAD && MY_ALLOC_LOCK != MY_ALLOC_LOCK_SPINLOCK
+#error "The thread cache requires POSIX threads to flush the cache of exiting threads."
+#endif
+    
+    // Slab layer for the default heap. Small requests are served from pages of equal, headerless slots
+    // carved from the arenas. myFree recognizes slab pointers by the page they belong to.
+    //#define MY_ALLOC_USE_SLABS
+#define SLAB_PAGE_SIZE              4096    // Power of two, pages are aligned to their size
+#define SLAB_MAX_SIZE               128     // Largest request served by slabs
+#define SLAB_CLASSES                (SLAB_MAX_SIZE / ALIGNMENT + 1)
+    
+    // Purge pass returning the whole pages of free blocks to the system with madvise(MADV_DONTNEED) (Linux only)
+    // MyAlloc_Purge() runs it on demand, the arenas of the default heap also run it every MY_ALLOC_PURGE_DECAY_MS
+    // Purged blocks are flagged as zero filled, they are not purged again until they are used
+    //#define MY_ALLOC_USE_PURGE
+#if !defined MY_ALLOC_PURGE_DECAY_MS
+#define MY_ALLOC_PURGE_DECAY_MS     10000   // 0 disables the periodic pass
+#endif
+#define MY_ALLOC_PURGE_CHECK        64      // Frees between two readings of the clock
+#if defined MY_ALLOC_USE_PURGE && !defined __linux__
+#error "The purge pass relies on MADV_DONTNEED refilling the pages with zeros, it requires Linux."
+#endif
+    
+    // Live counters of the default heap, read with MyAlloc_GetStats()
+    // Events are counted by each thread on its own counters, which are summed only when they are read
+    //#define MY_ALLOC_USE_STATS
+#define MY_ALLOC_STATS_CLASSES      (8 * sizeof(size_t)) // Class i counts the blocks whose usable size is in [2^i, 2^(i+1))
+    
     
     
     
@@ -116,31 +283,196 @@ extern "C" {
     // *****************************************************************************
     // *****************************************************************************
     
+#if defined MY_ALLOC_RELATIVE_HEADER && defined USE_CACHE_LINE_BYTES
+#error "Compact and boundary tag headers cannot be padded to the cache line."
+#endif
+    
+#if defined MY_ALLOC_COMPACT_HEADER
+    /*
+     * Blocks are linked by their distance in ALIGNMENT units, 0 marks the first block.
+     * The last block stores its distance to the end of the arena, so every block knows its size.
+     */
+    typedef struct METADATA_T {
+        uint32_t prev : 31; // Distance from the previous block
+        uint32_t free : 1;
+        uint32_t next : 30; // Distance to the next block, max size 4 GBytes with the 32-bit header
+        uint32_t zero : 1;
+        uint32_t last : 1;
+    } METADATA_T;
+#elif defined MY_ALLOC_BOUNDARY_TAGS
+    /*
+     * The header holds the distance to the next block in ALIGNMENT units, the last block stores its distance to the end of the arena.
+     * The last word of a free block (footer) repeats its distance in bytes, so the following block can find its header
+     * when its prevFree flag is set.
+     */
+    typedef struct METADATA_T {
+        BLOCK_SIZE_T next : BLOCK_SIZE_BITS - 2; // Max size 1 GBytes with the 32-bit header
+        BLOCK_SIZE_T zero : 1;
+        BLOCK_SIZE_T free : 1;
+        BLOCK_SIZE_T prevFree : 1;
+        BLOCK_SIZE_T last : 1;
+    } METADATA_T;
+#else
     /*
      * This structure is used to hold block meta-data linked list.
      * There are two pointers, next and previous structures in the list
      * A boolean type indicates, if the block is free (true) or used (false)
+     * A free block marked as zero holds only zero bytes after its free list node
      */
     typedef struct METADATA_T {
 #if defined USE_PADDING_BYTES
         uint8_t dummy[PADDING_BYTES_SIZE];
 #endif
         struct {
-            uint32_t size : 31; // Max size 2 GBytes
-            uint32_t free : 1;
+            BLOCK_SIZE_T size : BLOCK_SIZE_BITS; // Max size 1 GBytes with the 32-bit header
+            BLOCK_SIZE_T zero : 1;
+            BLOCK_SIZE_T free : 1;
         };
         struct METADATA_T *prev;
         struct METADATA_T *next;
     } METADATA_T;
+#endif
+    
+#if defined MY_ALLOC_USE_FREE_TREE
+    /*
+     * Free blocks are additionally indexed by an AVL tree through their unused payload.
+     * Nodes are ordered by payload size, the address breaks the ties, so every node is unique.
+     * Each node knows the lowest address of its subtree to answer first-fit queries.
+     */
+    typedef struct FREE_NODE_T {
+        struct METADATA_T *left;
+        struct METADATA_T *right;
+        struct METADATA_T *lowest; // Block with the lowest address in the subtree
+        size_t height;
+    } FREE_NODE_T;
+#else
+    /*
+     * Free blocks are additionally linked in segregated lists through their unused payload.
+     * The list of class i holds the free blocks whose payload size is in [2^i, 2^(i+1)).
+     */
+    typedef struct FREE_NODE_T {
+        struct METADATA_T *prev;
+        struct METADATA_T *next;
+    } FREE_NODE_T;
+#endif
+    
+#if defined USE_TLSF
+    /*
+     * TLSF splits each power-of-two class (first level) in 2^TLSF_SL_INDEX_COUNT_LOG2 linear ranges (second level).
+     * Sizes below TLSF_SMALL_BLOCK_SIZE share the first class and are split by ALIGNMENT.
+     * Lists are stored flat, the list of (fl, sl) is freelist[fl * TLSF_SL_INDEX_COUNT + sl].
+     */
+#define TLSF_SL_INDEX_COUNT_LOG2    4
+#define TLSF_SL_INDEX_COUNT         (1 << TLSF_SL_INDEX_COUNT_LOG2)
+#define TLSF_ALIGNMENT_LOG2         (ALIGNMENT == 16 ? 4 : ALIGNMENT == 8 ? 3 : 2)
+#define TLSF_FL_INDEX_SHIFT         (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGNMENT_LOG2)
+#define TLSF_FL_INDEX_COUNT         (sizeof(size_t) * 8 - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_SMALL_BLOCK_SIZE       (1 << TLSF_FL_INDEX_SHIFT)
+#define FREE_LIST_CLASSES           (TLSF_FL_INDEX_COUNT * TLSF_SL_INDEX_COUNT)
+#else
+    // One size class for each bit of size_t, a non-empty class sets its bit in freeBitmap
+    // With USE_BUDDY the class of a block is its order, i.e. the log2 of its header and payload bytes
+#define FREE_LIST_CLASSES           (sizeof(size_t) * 8)
+#endif
+    // A free block must be able to hold its free list node
+#if defined MY_ALLOC_BOUNDARY_TAGS
+#define MIN_PAYLOAD_SIZE            (ALIGN(sizeof(FREE_NODE_T) + sizeof(size_t) + METADATA_T_ALIGNED) - METADATA_T_ALIGNED)
+#else
+#define MIN_PAYLOAD_SIZE            (ALIGN(sizeof(FREE_NODE_T) + METADATA_T_ALIGNED) - METADATA_T_ALIGNED)
+#endif
     
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD
+#include <pthread.h>
+    typedef pthread_mutex_t MY_ALLOC_LOCK_T;
+#define MY_ALLOC_LOCK_INITIALIZER   PTHREAD_MUTEX_INITIALIZER
+#elif MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK
+    typedef volatile uint32_t MY_ALLOC_LOCK_T;
+#define MY_ALLOC_LOCK_INITIALIZER   0
+#else
+    typedef uint8_t MY_ALLOC_LOCK_T; // Not used
+#define MY_ALLOC_LOCK_INITIALIZER   0
+#endif
+    
+    /*
+     * This structure describes one heap: an arena of the default heap or an instance
+     * created by MyAlloc_Create(). A pointer to it is the handle of the heap.
+     */
     typedef struct {
+        MY_ALLOC_LOCK_T lock;
+        bool threadSafe;
         METADATA_T* blocklist;
+#if defined MY_ALLOC_USE_FREE_TREE
+        METADATA_T* freeTree; // Root of the tree of free blocks
+#else
+        METADATA_T* freelist[FREE_LIST_CLASSES];
+        size_t freeBitmap; // With USE_TLSF one bit for each non-empty first level
+#endif
+#if defined USE_TLSF
+        uint32_t slBitmap[TLSF_FL_INDEX_COUNT];
+#endif
         size_t heapStartAddress;
         size_t heapEndAddress;
         size_t heapSize;
         size_t requests;
+        size_t usedSize; // Bytes of used blocks, headers included
+        size_t freeBytes; // Payload bytes of the blocks in the free lists
+        size_t largestFree; // Payload bytes of the largest block in the free lists
+#if defined MY_ALLOC_USE_STATS
+        size_t peakSize; // Highest usedSize
+        size_t blocks; // Blocks of the chain, used and free
+#endif
+#if defined MY_ALLOC_USE_PURGE
+        uint64_t purgeTime; // Time of the last purge pass in milliseconds
+        uint32_t purgeFrees; // Frees since the clock was last read
+#endif
+#if defined MY_ALLOC_USE_MMAP
+        size_t committedEnd; // Accessible pages end here, the rest of the arena is only reserved
+#endif
+#if defined MY_ALLOC_USE_REMOTE_FREE
+        METADATA_T* remoteFree; // Blocks released by other threads, linked through their payload
+#endif
+#if defined MY_ALLOC_USE_SLABS
+        struct SLAB_PAGE_T* slabs[SLAB_CLASSES]; // Pages with free slots of each slot size
+        struct SLAB_PAGE_T* slabSpare[SLAB_CLASSES]; // Empty page kept to avoid carving a page at every allocation
+#endif
     } MY_ALLOC;
     
+    /*
+     * Options of a heap instance, see MyAlloc_Create()
+     */
+    typedef struct {
+        bool threadSafe; // Protect the instance with the lock policy selected by MY_ALLOC_LOCK
+        bool zeroed; // The region is known to be zero filled, e.g. fresh from mmap(), myCalloc skips the memset
+    } MY_ALLOC_CONFIG;
+    
+    /*
+     * Occupancy of one arena or heap instance, see MyAlloc_GetArenaStats() and MyAlloc_GetHeapStats()
+     */
+    typedef struct {
+        size_t heapStartAddress;
+        size_t heapSize;
+        size_t usedSize;
+        size_t freeSize;
+        size_t largestFree; // Payload bytes of the largest free block
+        size_t committedSize; // Accessible bytes, less than heapSize only for the arenas of an mmap-backed heap
+        size_t requests;
+    } MY_ALLOC_ARENA_STATS;
+    
+    /*
+     * Counters of the default heap, see MyAlloc_GetStats()
+     */
+    typedef struct {
+        size_t usedSize; // Bytes of used blocks, headers included
+        size_t freeSize;
+        size_t peakSize; // Sum of the highest usedSize of each arena
+        size_t blocks; // Blocks of the chains, used and free
+        uint64_t allocs[MY_ALLOC_STATS_CLASSES]; // Allocations by usable size class
+        uint64_t frees[MY_ALLOC_STATS_CLASSES]; // Releases by usable size class
+        uint64_t splits;
+        uint64_t coalesces;
+        uint64_t failures; // Allocations that returned NULL
+    } MY_ALLOC_STATS;
+    
     
     // *****************************************************************************
     // *****************************************************************************
@@ -151,8 +483,40 @@ extern "C" {
     // Basic functions
     void* myMalloc(size_t length);
     void myFree(void* ptr);
+    void* myRealloc(void* ptr, size_t length);
+    void* myCalloc(size_t count, size_t length);
+    void* myAlignedAlloc(size_t alignment, size_t length);
+    
+    // Heap instances, myMalloc and myFree use the default heap
+    MY_ALLOC* MyAlloc_Create(void* region, size_t size, const MY_ALLOC_CONFIG* config);
+    void MyAlloc_Destroy(MY_ALLOC* heap);
+    void* MyAlloc_MallocFrom(MY_ALLOC* heap, size_t length);
+    void MyAlloc_FreeTo(MY_ALLOC* heap, void* ptr);
+    void* MyAlloc_ReallocFrom(MY_ALLOC* heap, void* ptr, size_t length);
+    void* MyAlloc_CallocFrom(MY_ALLOC* heap, size_t count, size_t length);
+    void* MyAlloc_AlignedAllocFrom(MY_ALLOC* heap, size_t alignment, size_t length);
+    
+#if MY_ALLOC_LOCK == MY_ALLOC_LOCK_USER
+    // Critical section hooks, to be implemented by the application (e.g., by disabling interrupts)
+    void MyAlloc_EnterCritical(void);
+    void MyAlloc_ExitCritical(void);
+#endif
     // Advanced functions
     size_t MyAlloc_GetRequestedSize(void* ptr);
+    size_t MyAlloc_GetUsableSize(void* ptr);
+    bool MyAlloc_GetArenaStats(unsigned int arena, MY_ALLOC_ARENA_STATS* stats);
+    bool MyAlloc_GetHeapStats(MY_ALLOC* heap, MY_ALLOC_ARENA_STATS* stats);
+    size_t MyAlloc_GetLargestFree(void);
+    double MyAlloc_GetFragmentation(void);
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    void MyAlloc_FlushThreadCache(void);
+#endif
+#if defined MY_ALLOC_USE_PURGE
+    size_t MyAlloc_Purge(void);
+#endif
+#if defined MY_ALLOC_USE_STATS
+    bool MyAlloc_GetStats(MY_ALLOC_STATS* stats);
+#endif
     
     // Debug functions
     void MyAlloc_PrintFreelist(void);
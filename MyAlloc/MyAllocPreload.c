@@ -0,0 +1,133 @@
+/** **************************************************************************
+ @Company
+ LP Systems https://lpsystems.eu
+ 
+ @File Name
+ MyAllocPreload.c
+ 
+ @Author
+ Luca Pascarella https://lucapascarella.com
+ 
+ @Summary
+ Replacement of the C library allocator for LD_PRELOAD.
+ 
+ @Description
+ This file exports the standard allocation functions backed by the default heap of MyAlloc, so that
+ unmodified binaries can run on MyAlloc by preloading the shared library:
+ 
+ gcc -shared -fPIC -O2 -DMY_ALLOC_NO_DEBUG_INFO -DDDR_SIZE=1073741824 MyAlloc.c MyAllocPreload.c -o libmyalloc.so
+ LD_PRELOAD=./libmyalloc.so ./program
+ 
+ The default heap is a static array, or with MY_ALLOC_USE_MMAP a reservation sized by the MYALLOC_HEAP_SIZE
+ environment variable, so the allocator works before any constructor runs, e.g. while the dynamic linker loads the libraries. Its locks are taken around fork() by the handlers MyAlloc registers.
+ Pointers that do not belong to the heap are ignored by free() and rejected by realloc().
+ 
+ @License
+ Copyright (C) 2016 LP Systems
+ 
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ in compliance with the License. You may obtain a copy of the License at
+ 
+ https://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software distributed under the License
+ is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ or implied. See the License for the specific language governing permissions and limitations under
+ the License.
+ ************************************************************************** */
+
+#include <errno.h>
+#include <unistd.h>
+#include "MyAlloc.h"
+
+#if defined MY_ALLOC_PRINT_DEBUG_INFO
+#error "Build the preload library with MY_ALLOC_NO_DEBUG_INFO, the debug prints call malloc() while the heap is initialized."
+#endif
+#if MY_ALLOC_LOCK != MY_ALLOC_LOCK_PTHREAD && MY_ALLOC_LOCK != MY_ALLOC_LOCK_SPINLOCK
+#error "The preload library replaces malloc() for every thread, it requires MY_ALLOC_LOCK_PTHREAD or MY_ALLOC_LOCK_SPINLOCK."
+#endif
+
+#define PRELOAD_EXPORT  __attribute__((visibility("default")))
+
+// The C library reports allocation failures through errno
+static inline void* checkResult(void* ptr) {
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+static inline bool isPowerOfTwo(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Zero bytes requests return a unique pointer, as the C library does
+PRELOAD_EXPORT void* malloc(size_t size) {
+    return checkResult(myMalloc(size ? size : 1));
+}
+
+PRELOAD_EXPORT void free(void* ptr) {
+    myFree(ptr);
+}
+
+PRELOAD_EXPORT void* calloc(size_t count, size_t size) {
+    if (count == 0 || size == 0)
+        count = size = 1;
+    return checkResult(myCalloc(count, size));
+}
+
+PRELOAD_EXPORT void* realloc(void* ptr, size_t size) {
+    if (ptr != NULL && size == 0) {
+        myFree(ptr);
+        return NULL;
+    }
+    return checkResult(myRealloc(ptr, size ? size : 1));
+}
+
+PRELOAD_EXPORT void* reallocarray(void* ptr, size_t count, size_t size) {
+    if (size != 0 && count > ((size_t) -1) / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, count * size);
+}
+
+PRELOAD_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t size) {
+    void* ptr;
+    
+    if (alignment < sizeof(void*) || !isPowerOfTwo(alignment))
+        return EINVAL;
+    if ((ptr = myAlignedAlloc(alignment, size ? size : 1)) == NULL)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+PRELOAD_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    if (!isPowerOfTwo(alignment)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return checkResult(myAlignedAlloc(alignment, size ? size : 1));
+}
+
+PRELOAD_EXPORT void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+PRELOAD_EXPORT void* valloc(size_t size) {
+    return aligned_alloc((size_t) sysconf(_SC_PAGESIZE), size);
+}
+
+PRELOAD_EXPORT void* pvalloc(size_t size) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    
+    return aligned_alloc(page, (size + page - 1) & ~(page - 1));
+}
+
+PRELOAD_EXPORT size_t malloc_usable_size(void* ptr) {
+    return MyAlloc_GetUsableSize(ptr);
+}
+
+/* *****************************************************************************
+ End of File
+ */
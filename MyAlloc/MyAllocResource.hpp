@@ -0,0 +1,165 @@
+/** **************************************************************************
+ @Company
+ LP Systems https://lpsystems.eu
+ 
+ @File Name
+ MyAllocResource.hpp
+ 
+ @Author
+ Luca Pascarella https://lucapascarella.com
+ 
+ @Summary
+ C++ adapters of MyAlloc for the standard containers.
+ 
+ @Description
+ This header-only file adapts MyAlloc to the C++17 allocator models. MyAllocResource is a
+ std::pmr::memory_resource drawing from the default heap or from a heap instance, to be passed to the
+ std::pmr containers. MyAllocator is a stateless allocator drawing from the default heap, to be used as
+ the allocator argument of the classic containers. Both honour the alignment of the allocated type and
+ throw std::bad_alloc when the heap is exhausted.
+ 
+ @License
+ Copyright (C) 2016 LP Systems
+ 
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ in compliance with the License. You may obtain a copy of the License at
+ 
+ https://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software distributed under the License
+ is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ or implied. See the License for the specific language governing permissions and limitations under
+ the License.
+ ************************************************************************** */
+
+#ifndef _MY_ALLOC_RESOURCE_HPP    /* Guard against multiple inclusion */
+#define _MY_ALLOC_RESOURCE_HPP
+
+
+/* ************************************************************************** */
+/* ************************************************************************** */
+/* Section: Included Files                                                    */
+/* ************************************************************************** */
+/* ************************************************************************** */
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include "MyAlloc.h"
+
+
+/* ************************************************************************** */
+/* ************************************************************************** */
+/* Section: Memory resource                                                   */
+/* ************************************************************************** */
+/* ************************************************************************** */
+
+/*
+ * Polymorphic memory resource backed by a MyAlloc heap. The resource does not own the heap,
+ * the heap must outlive every container using the resource.
+ */
+class MyAllocResource : public std::pmr::memory_resource {
+public:
+    
+    // NULL selects the default heap
+    explicit MyAllocResource(MY_ALLOC* heap = NULL) noexcept : heap(heap) {
+    }
+    
+    MY_ALLOC* getHeap() const noexcept {
+        return heap;
+    }
+    
+protected:
+    
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        void* ptr;
+        
+        // Zero bytes requests are valid for a memory resource, not for MyAlloc
+        if (bytes == 0)
+            bytes = 1;
+        if (alignment <= ALIGNMENT)
+            ptr = heap ? MyAlloc_MallocFrom(heap, bytes) : myMalloc(bytes);
+        else
+            ptr = heap ? MyAlloc_AlignedAllocFrom(heap, alignment, bytes) : myAlignedAlloc(alignment, bytes);
+        if (ptr == NULL)
+            throw std::bad_alloc();
+        return ptr;
+    }
+    
+    void do_deallocate(void* ptr, std::size_t /* bytes */, std::size_t /* alignment */) override {
+        if (heap)
+            MyAlloc_FreeTo(heap, ptr);
+        else
+            myFree(ptr);
+    }
+    
+    // Memory of a resource can be released by any resource of the same heap
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        const MyAllocResource* resource = dynamic_cast<const MyAllocResource*> (&other);
+        return resource != NULL && resource->heap == heap;
+    }
+    
+private:
+    
+    MY_ALLOC* heap;
+};
+
+
+/* ************************************************************************** */
+/* ************************************************************************** */
+/* Section: Allocator                                                         */
+/* ************************************************************************** */
+/* ************************************************************************** */
+
+/*
+ * Stateless allocator backed by the default heap, every instance can release the memory of any other.
+ */
+template <typename T>
+class MyAllocator {
+public:
+    
+    typedef T value_type;
+    
+    MyAllocator() noexcept {
+    }
+    
+    template <typename U>
+    MyAllocator(const MyAllocator<U>&) noexcept {
+    }
+    
+    T* allocate(std::size_t count) {
+        void* ptr;
+        
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_array_new_length();
+        std::size_t bytes = count ? count * sizeof(T) : 1;
+        if (alignof(T) <= ALIGNMENT)
+            ptr = myMalloc(bytes);
+        else
+            ptr = myAlignedAlloc(alignof(T), bytes);
+        if (ptr == NULL)
+            throw std::bad_alloc();
+        return static_cast<T*> (ptr);
+    }
+    
+    void deallocate(T* ptr, std::size_t /* count */) noexcept {
+        myFree(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const MyAllocator<T>&, const MyAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const MyAllocator<T>&, const MyAllocator<U>&) noexcept {
+    return false;
+}
+
+#endif /* _MY_ALLOC_RESOURCE_HPP */
+
+/* *****************************************************************************
+ End of File
+ */
@@ -0,0 +1,253 @@
+/** **************************************************************************
+ @Company
+ LP Systems https://lpsystems.eu
+ 
+ @File Name
+ MyArena.c
+ 
+ @Author
+ Luca Pascarella https://lucapascarella.com
+ 
+ @Summary
+ Implementation of a region allocator built on top of MyAlloc.
+ 
+ @Description
+ This file contains the implementation of a region (arena) allocator. Objects are bump-allocated
+ from chunks taken from MyAlloc, so allocating costs a pointer increment and releasing a whole
+ request costs one myFree() per chunk instead of one per object.
+ 
+ @License
+ Copyright (C) 2016 LP Systems
+ 
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ in compliance with the License. You may obtain a copy of the License at
+ 
+ https://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software distributed under the License
+ is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ or implied. See the License for the specific language governing permissions and limitations under
+ the License.
+ ************************************************************************** */
+
+#include <stdint.h>
+#include "MyArena.h"
+
+#define MY_ARENA_ALIGNED        ALIGN(sizeof(MY_ARENA))
+#define MY_ARENA_CHUNK_ALIGNED  ALIGN(sizeof(MY_ARENA_CHUNK_T))
+
+// The first chunk follows the descriptor in the same block
+#define firstChunk(arena)       ((MY_ARENA_CHUNK_T*) ((char*) (arena) + MY_ARENA_ALIGNED))
+
+static void* chunkAllocate(MY_ALLOC* heap, size_t size) {
+    return heap ? MyAlloc_MallocFrom(heap, size) : myMalloc(size);
+}
+
+static void chunkRelease(MY_ALLOC* heap, void* ptr) {
+    if (heap)
+        MyAlloc_FreeTo(heap, ptr);
+    else
+        myFree(ptr);
+}
+
+/**
+ @Function
+ MY_ARENA* MyArena_Create(MY_ALLOC* heap, size_t chunkSize)
+ 
+ @Summary
+ Creates an arena.
+ 
+ @Description
+ The descriptor and the first chunk are taken from the heap with a single allocation. Further
+ chunks are taken when the current one is exhausted, requests larger than a chunk get a chunk of their own.
+ 
+ @Precondition
+ None.
+ 
+ @Parameters
+ @param heap Is the heap providing the chunks, NULL selects the default heap.
+ @param chunkSize Is the size of the chunks in bytes, zero selects MY_ARENA_CHUNK_SIZE.
+ 
+ @Returns
+ Returns the arena or NULL if the heap is out of memory.
+ */
+MY_ARENA* MyArena_Create(MY_ALLOC* heap, size_t chunkSize) {
+    MY_ARENA* arena;
+    MY_ARENA_CHUNK_T* chunk;
+    
+    if (chunkSize == 0)
+        chunkSize = MY_ARENA_CHUNK_SIZE;
+    chunkSize = ALIGN(chunkSize);
+    if (chunkSize < 2 * MY_ARENA_CHUNK_ALIGNED || chunkSize > SIZE_MAX - MY_ARENA_ALIGNED)
+        return NULL;
+    
+    if ((arena = (MY_ARENA*) chunkAllocate(heap, MY_ARENA_ALIGNED + chunkSize)) == NULL)
+        return NULL;
+    chunk = firstChunk(arena);
+    chunk->prev = NULL;
+    chunk->end = (char*) chunk + chunkSize;
+    arena->heap = heap;
+    arena->chunk = chunk;
+    arena->cursor = (char*) chunk + MY_ARENA_CHUNK_ALIGNED;
+    arena->chunkSize = chunkSize;
+    return arena;
+}
+
+/**
+ @Function
+ void MyArena_Destroy(MY_ARENA* arena)
+ 
+ @Summary
+ Destroys an arena.
+ 
+ @Description
+ Every chunk, and the descriptor, goes back to the heap. The memory handed out by the arena must not be used anymore.
+ 
+ @Precondition
+ MyArena_Create must be called and returns successully.
+ 
+ @Parameters
+ @param arena Is the arena to destroy.
+ */
+void MyArena_Destroy(MY_ARENA* arena) {
+    if (arena == NULL)
+        return;
+    MyArena_Reset(arena);
+    chunkRelease(arena->heap, arena);
+}
+
+/**
+ @Function
+ void* MyArena_Alloc(MY_ARENA* arena, size_t size)
+ 
+ @Summary
+ Allocates memory from an arena.
+ 
+ @Description
+ The memory is taken from the current chunk by advancing the cursor, a new chunk is taken
+ from the heap only when the current one is exhausted. The memory is aligned to ALIGNMENT.
+ 
+ @Precondition
+ MyArena_Create must be called and returns successully.
+ 
+ @Parameters
+ @param arena Is the arena.
+ @param size Is the required space in bytes.
+ 
+ @Returns
+ Returns the pointer to the memory or NULL if the heap is out of memory.
+ */
+void* MyArena_Alloc(MY_ARENA* arena, size_t size) {
+    MY_ARENA_CHUNK_T* chunk;
+    size_t chunkSize;
+    char* ptr;
+    
+    // Check required space is bigger than zero and does not overflow the chunk size
+    if (size <= 0 || size > SIZE_MAX - ALIGNMENT - MY_ARENA_CHUNK_ALIGNED)
+        return NULL;
+    size = ALIGN(size);
+    
+    // Fast path, bump the cursor
+    if (size <= (size_t) (arena->chunk->end - arena->cursor)) {
+        ptr = arena->cursor;
+        arena->cursor += size;
+        return ptr;
+    }
+    
+    // The rest of the current chunk is abandoned until the next reset
+    chunkSize = MY_ARENA_CHUNK_ALIGNED + size;
+    if (chunkSize < arena->chunkSize)
+        chunkSize = arena->chunkSize;
+    if ((chunk = (MY_ARENA_CHUNK_T*) chunkAllocate(arena->heap, chunkSize)) == NULL)
+        return NULL;
+    chunk->prev = arena->chunk;
+    chunk->end = (char*) chunk + chunkSize;
+    arena->chunk = chunk;
+    ptr = (char*) chunk + MY_ARENA_CHUNK_ALIGNED;
+    arena->cursor = ptr + size;
+    return ptr;
+}
+
+/**
+ @Function
+ void MyArena_Reset(MY_ARENA* arena)
+ 
+ @Summary
+ Releases all the memory handed out by an arena.
+ 
+ @Description
+ The chunks taken after the first one go back to the heap, the first chunk is kept for reuse.
+ 
+ @Precondition
+ MyArena_Create must be called and returns successully.
+ 
+ @Parameters
+ @param arena Is the arena.
+ */
+void MyArena_Reset(MY_ARENA* arena) {
+    MY_ARENA_MARKER marker;
+    
+    marker.chunk = firstChunk(arena);
+    marker.cursor = (char*) marker.chunk + MY_ARENA_CHUNK_ALIGNED;
+    MyArena_Restore(arena, marker);
+}
+
+/**
+ @Function
+ MY_ARENA_MARKER MyArena_Save(MY_ARENA* arena)
+ 
+ @Summary
+ Takes a marker of the current position of an arena.
+ 
+ @Description
+ Markers can be nested, they must be restored in reverse order.
+ 
+ @Precondition
+ MyArena_Create must be called and returns successully.
+ 
+ @Parameters
+ @param arena Is the arena.
+ 
+ @Returns
+ Returns the marker to pass to MyArena_Restore().
+ */
+MY_ARENA_MARKER MyArena_Save(MY_ARENA* arena) {
+    MY_ARENA_MARKER marker;
+    
+    marker.chunk = arena->chunk;
+    marker.cursor = arena->cursor;
+    return marker;
+}
+
+/**
+ @Function
+ void MyArena_Restore(MY_ARENA* arena, MY_ARENA_MARKER marker)
+ 
+ @Summary
+ Rewinds an arena to a marker.
+ 
+ @Description
+ The memory handed out after the marker was taken is released, the chunks taken after it go back to the heap.
+ Markers taken after this one become invalid.
+ 
+ @Precondition
+ The marker must be taken with MyArena_Save() on the same arena, after its last reset.
+ 
+ @Parameters
+ @param arena Is the arena.
+ @param marker Is the position to rewind to.
+ */
+void MyArena_Restore(MY_ARENA* arena, MY_ARENA_MARKER marker) {
+    MY_ARENA_CHUNK_T* chunk;
+    
+    while (arena->chunk != marker.chunk) {
+        chunk = arena->chunk;
+        arena->chunk = chunk->prev;
+        chunkRelease(arena->heap, chunk);
+    }
+    arena->cursor = marker.cursor;
+}
+
+/* *****************************************************************************
+ End of File
+ */
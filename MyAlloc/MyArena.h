@@ -0,0 +1,118 @@
+/** **************************************************************************
+ @Company
+ LP Systems https://lpsystems.eu
+ 
+ @File Name
+ MyArena.h
+ 
+ @Author
+ Luca Pascarella https://lucapascarella.com
+ 
+ @Summary
+ Header of a region allocator built on top of MyAlloc.
+ 
+ @Description
+ This file is the header of a region (arena) allocator. An arena takes large chunks from MyAlloc
+ and hands out memory from them by bumping a pointer. Single objects are never released, the whole
+ arena is released at once with MyArena_Reset() or MyArena_Destroy(), or back to a marker taken with
+ MyArena_Save(). An arena is not thread-safe, it is meant to be owned by a single request or thread.
+ 
+ @License
+ Copyright (C) 2016 LP Systems
+ 
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ in compliance with the License. You may obtain a copy of the License at
+ 
+ https://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software distributed under the License
+ is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ or implied. See the License for the specific language governing permissions and limitations under
+ the License.
+ ************************************************************************** */
+
+#ifndef _MY_ARENA_H    /* Guard against multiple inclusion */
+#define _MY_ARENA_H
+
+
+/* ************************************************************************** */
+/* ************************************************************************** */
+/* Section: Included Files                                                    */
+/* ************************************************************************** */
+/* ************************************************************************** */
+
+#include "MyAlloc.h"
+
+/* Provide C++ Compatibility */
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    
+    /* ************************************************************************** */
+    /* ************************************************************************** */
+    /* Section: Constants                                                         */
+    /* ************************************************************************** */
+    /* ************************************************************************** */
+    
+    // Default size of the chunks taken from MyAlloc, including the chunk header
+#define MY_ARENA_CHUNK_SIZE     1024
+    
+    
+    // *****************************************************************************
+    // *****************************************************************************
+    // Section: Data Types
+    // *****************************************************************************
+    // *****************************************************************************
+    
+    /*
+     * Header of a chunk, chunks are linked from the newest to the oldest
+     */
+    typedef struct MY_ARENA_CHUNK_T {
+        struct MY_ARENA_CHUNK_T* prev;
+        char* end;
+    } MY_ARENA_CHUNK_T;
+    
+    /*
+     * Descriptor of an arena, created by MyArena_Create(). It shares the first chunk,
+     * which is kept across resets.
+     */
+    typedef struct {
+        MY_ALLOC* heap;                 // NULL takes the chunks from the default heap
+        MY_ARENA_CHUNK_T* chunk;        // Current chunk
+        char* cursor;                   // First free byte of the current chunk
+        size_t chunkSize;
+    } MY_ARENA;
+    
+    /*
+     * Position of an arena, see MyArena_Save() and MyArena_Restore()
+     */
+    typedef struct {
+        MY_ARENA_CHUNK_T* chunk;
+        char* cursor;
+    } MY_ARENA_MARKER;
+    
+    
+    // *****************************************************************************
+    // *****************************************************************************
+    // Section: Interface Functions
+    // *****************************************************************************
+    // *****************************************************************************
+    
+    MY_ARENA* MyArena_Create(MY_ALLOC* heap, size_t chunkSize);
+    void MyArena_Destroy(MY_ARENA* arena);
+    void* MyArena_Alloc(MY_ARENA* arena, size_t size);
+    void MyArena_Reset(MY_ARENA* arena);
+    MY_ARENA_MARKER MyArena_Save(MY_ARENA* arena);
+    void MyArena_Restore(MY_ARENA* arena, MY_ARENA_MARKER marker);
+    
+    /* Provide C++ Compatibility */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MY_ARENA_H */
+
+/* *****************************************************************************
+ End of File
+ */
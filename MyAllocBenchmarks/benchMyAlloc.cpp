@@ -0,0 +1,339 @@
+/** **************************************************************************
+ @Company
+ LP Systems https://lpsystems.eu
+ 
+ @File Name
+ benchMyAlloc.cpp
+ 
+ @Author
+ Luca Pascarella https://lucapascarella.com
+ 
+ @Summary
+ Microbenchmarks of the myMalloc/myFree hot paths.
+ 
+ @Description
+ This program times each allocation and release of a set of standard scenarios on the default heap
+ and, as a baseline, on the C library allocator. The latencies are reported as percentiles in CSV or JSON.
+ The search algorithm is selected at compile time, so the program is built once for each of them:
+ 
+ gcc -std=gnu11 -O2 -DMY_ALLOC_NO_DEBUG_INFO -DDDR_SIZE=268435456 -DUSE_FIRST_FIT -c MyAlloc/MyAlloc.c -o MyAlloc.o
+ g++ -std=c++17 -O2 -DMY_ALLOC_NO_DEBUG_INFO -DDDR_SIZE=268435456 -DUSE_FIRST_FIT -IMyAlloc MyAllocBenchmarks/benchMyAlloc.cpp MyAlloc.o -lpthread -o bench-first-fit
+ ./bench-first-fit > results.csv
+ ./bench-best-fit --no-header >> results.csv # Built without USE_FIRST_FIT
+ 
+ Options: --json selects JSON output, --no-header omits the CSV header, --ops N sets the operations of each scenario,
+ --seed N sets the seed of the random scenarios. The working sets are sized on MAX_HEAP_SIZE, a heap of a few
+ hundred MBytes keeps them out of the caches.
+ 
+ @License
+ Copyright (C) 2016 LP Systems
+ 
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except
+ in compliance with the License. You may obtain a copy of the License at
+ 
+ https://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software distributed under the License
+ is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ or implied. See the License for the specific language governing permissions and limitations under
+ the License.
+ ************************************************************************** */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include "MyAlloc.h"
+
+#if defined USE_FIRST_FIT
+#define ENGINE_NAME             "first-fit"
+#elif defined USE_TLSF
+#define ENGINE_NAME             "tlsf"
+#elif defined USE_BUDDY
+#define ENGINE_NAME             "buddy"
+#else
+#define ENGINE_NAME             "best-fit"
+#endif
+
+#define DEFAULT_OPS             200000
+#define SMALL_SIZE              64      // Request of the ping-pong and batch scenarios
+#define CHURN_MIN_SIZE          16
+#define CHURN_MAX_SIZE          4096
+#define WORKING_SET_SHARE       4       // A scenario keeps at most MAX_HEAP_SIZE / WORKING_SET_SHARE bytes live
+#define BATCH_MAX               4096
+
+typedef std::chrono::steady_clock CLOCK_T;
+
+/*
+ * An allocator under test, the default heap or the C library
+ */
+typedef struct {
+    const char* name;
+    void* (*allocate)(size_t size);
+    void (*release)(void* ptr);
+} ALLOCATOR_T;
+
+/*
+ * Latencies of one kind of operation, in nanoseconds
+ */
+typedef struct {
+    std::vector<uint32_t> samples;
+    size_t failures;
+} SAMPLES_T;
+
+/*
+ * One row of the report
+ */
+typedef struct {
+    std::string scenario;
+    std::string allocator;
+    std::string operation;
+    size_t count;
+    size_t failures;
+    double mean;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t p999;
+} RESULT_T;
+
+static uint32_t timerOverhead; // Cost of reading the clock twice, taken off each sample
+
+// Nanoseconds between two readings of the clock without the cost of the readings
+static inline uint32_t elapsed(CLOCK_T::time_point start, CLOCK_T::time_point stop) {
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    
+    return ns > timerOverhead ? (uint32_t) (ns - timerOverhead) : 0;
+}
+
+// Median of the empty timed region
+static void calibrateTimer(void) {
+    std::vector<uint32_t> samples(10000);
+    
+    timerOverhead = 0;
+    for (auto& sample : samples) {
+        CLOCK_T::time_point start = CLOCK_T::now();
+        sample = elapsed(start, CLOCK_T::now());
+    }
+    std::sort(samples.begin(), samples.end());
+    timerOverhead = samples[samples.size() / 2];
+}
+
+// Timed allocation, the first byte is written out of the timed region so the block is really touched
+static inline void* timedAllocate(const ALLOCATOR_T* allocator, size_t size, SAMPLES_T* samples) {
+    CLOCK_T::time_point start = CLOCK_T::now();
+    void* ptr = allocator->allocate(size);
+    CLOCK_T::time_point stop = CLOCK_T::now();
+    
+    if (ptr == NULL) {
+        samples->failures++;
+        return NULL;
+    }
+    *(volatile char*) ptr = 0;
+    samples->samples.push_back(elapsed(start, stop));
+    return ptr;
+}
+
+// Timed release, NULL pointers of failed allocations are skipped
+static inline void timedRelease(const ALLOCATOR_T* allocator, void* ptr, SAMPLES_T* samples) {
+    if (ptr == NULL)
+        return;
+    CLOCK_T::time_point start = CLOCK_T::now();
+    allocator->release(ptr);
+    CLOCK_T::time_point stop = CLOCK_T::now();
+    samples->samples.push_back(elapsed(start, stop));
+}
+
+// Blocks of the given size that fit the share of the heap a scenario may keep live
+static size_t workingSetBlocks(size_t size, size_t limit) {
+    size_t blocks = MAX_HEAP_SIZE / WORKING_SET_SHARE / (size + 2 * sizeof(METADATA_T));
+    
+    return std::max((size_t) 1, std::min(blocks, limit));
+}
+
+// Allocation immediately followed by its release, the fastest path of any allocator
+static void scenarioPingPong(const ALLOCATOR_T* allocator, size_t ops, std::mt19937_64&, SAMPLES_T* allocs, SAMPLES_T* frees) {
+    size_t i;
+    
+    for (i = 0; i < ops; i++)
+        timedRelease(allocator, timedAllocate(allocator, SMALL_SIZE, allocs), frees);
+}
+
+// Batches released in the reverse order of allocation
+static void scenarioLifo(const ALLOCATOR_T* allocator, size_t ops, std::mt19937_64&, SAMPLES_T* allocs, SAMPLES_T* frees) {
+    std::vector<void*> batch(workingSetBlocks(SMALL_SIZE, BATCH_MAX));
+    size_t done, i;
+    
+    for (done = 0; done < ops; done += batch.size()) {
+        for (i = 0; i < batch.size(); i++)
+            batch[i] = timedAllocate(allocator, SMALL_SIZE, allocs);
+        for (i = batch.size(); i > 0; i--)
+            timedRelease(allocator, batch[i - 1], frees);
+    }
+}
+
+// Batches released in the order of allocation
+static void scenarioFifo(const ALLOCATOR_T* allocator, size_t ops, std::mt19937_64&, SAMPLES_T* allocs, SAMPLES_T* frees) {
+    std::vector<void*> batch(workingSetBlocks(SMALL_SIZE, BATCH_MAX));
+    size_t done, i;
+    
+    for (done = 0; done < ops; done += batch.size()) {
+        for (i = 0; i < batch.size(); i++)
+            batch[i] = timedAllocate(allocator, SMALL_SIZE, allocs);
+        for (i = 0; i < batch.size(); i++)
+            timedRelease(allocator, batch[i], frees);
+    }
+}
+
+// Random slots of a fixed table are released when used and refilled with a random size otherwise
+static void scenarioChurn(const ALLOCATOR_T* allocator, size_t ops, std::mt19937_64& random, SAMPLES_T* allocs, SAMPLES_T* frees) {
+    std::vector<void*> slots(workingSetBlocks((CHURN_MIN_SIZE + CHURN_MAX_SIZE) / 2, ops / 4 + 1), NULL);
+    std::uniform_int_distribution<size_t> slot(0, slots.size() - 1);
+    std::uniform_int_distribution<size_t> size(CHURN_MIN_SIZE, CHURN_MAX_SIZE);
+    size_t i;
+    
+    for (i = 0; i < ops; i++) {
+        void*& ptr = slots[slot(random)];
+        if (ptr) {
+            timedRelease(allocator, ptr, frees);
+            ptr = NULL;
+        } else {
+            ptr = timedAllocate(allocator, size(random), allocs);
+        }
+    }
+    for (void* ptr : slots)
+        allocator->release(ptr);
+}
+
+// The live set keeps growing: three blocks are allocated for each random one released
+static void scenarioGrowing(const ALLOCATOR_T* allocator, size_t ops, std::mt19937_64& random, SAMPLES_T* allocs, SAMPLES_T* frees) {
+    std::vector<void*> live;
+    std::uniform_int_distribution<size_t> size(CHURN_MIN_SIZE, CHURN_MAX_SIZE / 4);
+    size_t limit = workingSetBlocks((CHURN_MIN_SIZE + CHURN_MAX_SIZE / 4) / 2, ops);
+    size_t i;
+    
+    for (i = 0; i < ops; i++) {
+        if (i % 4 == 3 && !live.empty()) {
+            std::swap(live[random() % live.size()], live.back());
+            timedRelease(allocator, live.back(), frees);
+            live.pop_back();
+        } else if (live.size() < limit) {
+            void* ptr = timedAllocate(allocator, size(random), allocs);
+            if (ptr)
+                live.push_back(ptr);
+        }
+    }
+    for (void* ptr : live)
+        allocator->release(ptr);
+}
+
+// Value below which the given share of the sorted samples falls
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double share) {
+    size_t index = (size_t) (share * sorted.size());
+    
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static RESULT_T summarize(const char* scenario, const char* allocator, const char* operation, SAMPLES_T* samples) {
+    RESULT_T result;
+    uint64_t total = 0;
+    
+    std::sort(samples->samples.begin(), samples->samples.end());
+    for (uint32_t sample : samples->samples)
+        total += sample;
+    result.scenario = scenario;
+    result.allocator = allocator;
+    result.operation = operation;
+    result.count = samples->samples.size();
+    result.failures = samples->failures;
+    result.mean = result.count ? (double) total / result.count : 0.0;
+    result.p50 = percentile(samples->samples, 0.50);
+    result.p99 = percentile(samples->samples, 0.99);
+    result.p999 = percentile(samples->samples, 0.999);
+    return result;
+}
+
+static void printCsv(const std::vector<RESULT_T>& results, bool header) {
+    if (header)
+        printf("scenario,allocator,operation,count,failures,mean_ns,p50_ns,p99_ns,p999_ns\n");
+    for (const RESULT_T& r : results)
+        printf("%s,%s,%s,%zu,%zu,%.1f,%u,%u,%u\n", r.scenario.c_str(), r.allocator.c_str(), r.operation.c_str(),
+                r.count, r.failures, r.mean, r.p50, r.p99, r.p999);
+}
+
+static void printJson(const std::vector<RESULT_T>& results) {
+    size_t i;
+    
+    printf("[\n");
+    for (i = 0; i < results.size(); i++) {
+        const RESULT_T& r = results[i];
+        printf("  {\"scenario\": \"%s\", \"allocator\": \"%s\", \"operation\": \"%s\", \"count\": %zu, \"failures\": %zu, "
+                "\"mean_ns\": %.1f, \"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u}%s\n", r.scenario.c_str(), r.allocator.c_str(),
+                r.operation.c_str(), r.count, r.failures, r.mean, r.p50, r.p99, r.p999, i + 1 < results.size() ? "," : "");
+    }
+    printf("]\n");
+}
+
+int main(int argc, const char* argv[]) {
+    typedef void (*SCENARIO_T)(const ALLOCATOR_T*, size_t, std::mt19937_64&, SAMPLES_T*, SAMPLES_T*);
+    static const struct {
+        const char* name;
+        SCENARIO_T run;
+    } scenarios[] = {
+        { "ping-pong", scenarioPingPong },
+        { "lifo-batch", scenarioLifo },
+        { "fifo-batch", scenarioFifo },
+        { "random-churn", scenarioChurn },
+        { "growing-set", scenarioGrowing },
+    };
+    static const ALLOCATOR_T allocators[] = {
+        { "myalloc-" ENGINE_NAME, myMalloc, myFree },
+        { "libc", malloc, free },
+    };
+    std::vector<RESULT_T> results;
+    size_t ops = DEFAULT_OPS;
+    unsigned long seed = 1;
+    bool json = false, header = true;
+    int i;
+    
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--no-header") == 0)
+            header = false;
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            ops = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "Usage: %s [--json] [--no-header] [--ops N] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+    
+    calibrateTimer();
+    myFree(myMalloc(SMALL_SIZE)); // The heap is initialized out of the timed regions
+    for (const auto& scenario : scenarios) {
+        for (const ALLOCATOR_T& allocator : allocators) {
+            SAMPLES_T allocs = { {}, 0 }, frees = { {}, 0 };
+            std::mt19937_64 random(seed); // Both allocators see the same sequence
+            allocs.samples.reserve(ops);
+            frees.samples.reserve(ops);
+            scenario.run(&allocator, ops, random, &allocs, &frees);
+            results.push_back(summarize(scenario.name, allocator.name, "malloc", &allocs));
+            results.push_back(summarize(scenario.name, allocator.name, "free", &frees));
+        }
+    }
+    
+    if (json)
+        printJson(results);
+    else
+        printCsv(results, header);
+    return 0;
+}
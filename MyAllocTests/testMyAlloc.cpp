@@ -6,8 +6,51 @@
 //  Copyright © 2018 Luca Pascarella. All rights reserved.
 //
 
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#if defined __unix__
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 #include "catch.hpp"
 #include "MyAlloc.h"
+#include "MyArena.h"
+#include "MyAllocResource.hpp"
+
+// Compact and boundary tag headers, and slab slots, report the usable size, which covers the requested one
+#if defined MY_ALLOC_RELATIVE_HEADER || defined MY_ALLOC_USE_SLABS || defined MY_ALLOC_USE_THREAD_CACHE
+#define REQUIRE_REQUESTED_SIZE(ptr, size)   REQUIRE(MyAlloc_GetRequestedSize(ptr) >= (size))
+#else
+#define REQUIRE_REQUESTED_SIZE(ptr, size)   REQUIRE(MyAlloc_GetRequestedSize(ptr) == (size))
+#endif
+
+// Slab slots share their page, the block chain accounts the whole page instead of each slot
+#if defined MY_ALLOC_USE_SLABS
+#define REQUIRE_CHAIN_SPACE(expr)
+#else
+#define REQUIRE_CHAIN_SPACE(expr)           REQUIRE(expr)
+#endif
+
+// Largest request expected to fit a free region, a buddy heap serves it from an aligned power-of-two block
+// and a region always holds one of at least a quarter of its size
+#if defined USE_BUDDY
+#define LARGE_REQUEST(size, num, den)       ((size) / 8)
+#else
+#define LARGE_REQUEST(size, num, den)       ((size) * (num) / (den))
+#endif
 
 TEST_CASE("Testing MyAlloc 1") {
     
@@ -24,9 +67,11 @@ TEST_CASE("Testing MyAlloc 1") {
         INFO("Must return the asked size") // Only appears on a FAIL
         p1 = (char*) myMalloc(123);
         REQUIRE(p1 != NULL);
-        size_t size = MyAlloc_GetRequestedSize(p1);
-        REQUIRE(size == 123);
+        REQUIRE_REQUESTED_SIZE(p1, 123);
+        REQUIRE(MyAlloc_GetUsableSize(p1) >= 123);
+        memset(p1, 0xA5, MyAlloc_GetUsableSize(p1));
         myFree(p1);
+        REQUIRE(MyAlloc_GetUsableSize(NULL) == 0);
     }
 }
 
@@ -40,10 +85,10 @@ TEST_CASE("Testing free/full space") {
         INFO("Ordinary allocation failed") // Only appears on a FAIL
         for (i = 0; i < ALLOC_MAX; i++) {
             p[i] = (char*) myMalloc(i+1);
-            REQUIRE(MyAlloc_GetRequestedSize(p[i]) == i+1);
+            REQUIRE_REQUESTED_SIZE(p[i], i+1);
             space += MyAlloc_GetTotalSize(p[i]);
         }
-        REQUIRE(MyAlloc_GetFullNonLinearSpace() == space);
+        REQUIRE_CHAIN_SPACE(MyAlloc_GetFullNonLinearSpace() == space);
         for (i = 0; i < ALLOC_MAX; i++) {
             myFree(p[i]);
         }
@@ -54,10 +99,10 @@ TEST_CASE("Testing free/full space") {
         INFO("Ordinary allocation failed") // Only appears on a FAIL
         for (i = 0; i < ALLOC_MAX; i++) {
             p[i] = (char*) myMalloc(i+1);
-            REQUIRE(MyAlloc_GetRequestedSize(p[i]) == i+1);
+            REQUIRE_REQUESTED_SIZE(p[i], i+1);
             space += MyAlloc_GetTotalSize(p[i]);
         }
-        REQUIRE(MyAlloc_GetFullNonLinearSpace() == space);
+        REQUIRE_CHAIN_SPACE(MyAlloc_GetFullNonLinearSpace() == space);
         for (i = ALLOC_MAX-1; i >= 0; i--)
             myFree(p[i]);
         REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
@@ -67,19 +112,19 @@ TEST_CASE("Testing free/full space") {
         INFO("Random allocation") // Only appears on a FAIL
         p1 = (char*) myMalloc(15);
         REQUIRE(p1 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p1) == 15);
+        REQUIRE_REQUESTED_SIZE(p1, 15);
         p2 = (char*) myMalloc(23);
         REQUIRE(p2 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p2) == 23);
+        REQUIRE_REQUESTED_SIZE(p2, 23);
         myFree(p1);
         p1 = (char*) myMalloc(32);
         REQUIRE(p1 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p1) == 32);
+        REQUIRE_REQUESTED_SIZE(p1, 32);
         p3 = (char*) myMalloc(8);
         REQUIRE(p3 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p3) == 8);
+        REQUIRE_REQUESTED_SIZE(p3, 8);
         
-        REQUIRE(MyAlloc_GetFullNonLinearSpace() == MyAlloc_GetTotalSize(p1) + MyAlloc_GetTotalSize(p2) + MyAlloc_GetTotalSize(p3));
+        REQUIRE_CHAIN_SPACE(MyAlloc_GetFullNonLinearSpace() == MyAlloc_GetTotalSize(p1) + MyAlloc_GetTotalSize(p2) + MyAlloc_GetTotalSize(p3));
         myFree(p1);
         myFree(p2);
         myFree(p3);
@@ -90,28 +135,28 @@ TEST_CASE("Testing free/full space") {
         INFO("Random complex allocation") // Only appears on a FAIL
         p1 = (char*) myMalloc(15);
         REQUIRE(p1 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p1) == 15);
+        REQUIRE_REQUESTED_SIZE(p1, 15);
         p2 = (char*) myMalloc(23);
         REQUIRE(p2 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p2) == 23);
+        REQUIRE_REQUESTED_SIZE(p2, 23);
         myFree(p1);
         p1 = (char*) myMalloc(32);
         REQUIRE(p1 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p1) == 32);
+        REQUIRE_REQUESTED_SIZE(p1, 32);
         p3 = (char*) myMalloc(8);
         REQUIRE(p3 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p3) == 8);
+        REQUIRE_REQUESTED_SIZE(p3, 8);
         myFree(p1);
         myFree(p2);
         p4 = (char*) myMalloc(64);
         REQUIRE(p3 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p4) == 64);
+        REQUIRE_REQUESTED_SIZE(p4, 64);
         p1 = (char*) myMalloc(17);
         REQUIRE(p1 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p1) == 17);
+        REQUIRE_REQUESTED_SIZE(p1, 17);
         p2 = (char*) myMalloc(34);
         REQUIRE(p2 != NULL);
-        REQUIRE(MyAlloc_GetRequestedSize(p2) == 34);
+        REQUIRE_REQUESTED_SIZE(p2, 34);
         myFree(p4);
         myFree(p3);
         myFree(p2);
@@ -120,6 +165,1556 @@ TEST_CASE("Testing free/full space") {
     }
 }
 
+TEST_CASE("Testing segregated free lists") {
+    char *p[ALLOC_MAX], *p1;
+    int i;
+    
+    SECTION("Hole reuse") {
+        INFO("A freed block must be reused by a request of the same size") // Only appears on a FAIL
+        for (i = 0; i < ALLOC_MAX; i++) {
+            p[i] = (char*) myMalloc(16);
+            REQUIRE(p[i] != NULL);
+        }
+        // Free every other block, neighbours are used so no coalescing happens
+        for (i = 0; i < ALLOC_MAX; i += 2)
+            myFree(p[i]);
+        p1 = (char*) myMalloc(16);
+        REQUIRE(p1 != NULL);
+        bool reused = false;
+        for (i = 0; i < ALLOC_MAX; i += 2)
+            reused |= (p1 == p[i]);
+        REQUIRE(reused);
+        myFree(p1);
+        for (i = 1; i < ALLOC_MAX; i += 2)
+            myFree(p[i]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+    
+    SECTION("Coalescing with both neighbours") {
+        INFO("Freeing the middle block must merge three blocks in one") // Only appears on a FAIL
+        for (i = 0; i < 3; i++)
+            p[i] = (char*) myMalloc(100);
+        myFree(p[0]);
+        myFree(p[2]);
+        myFree(p[1]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+        // The arena is a single large free block again
+        p1 = (char*) myMalloc(LARGE_REQUEST(MAX_HEAP_SIZE / MY_ALLOC_ARENAS, 3, 4));
+        REQUIRE(p1 != NULL);
+        myFree(p1);
+    }
+}
+
+TEST_CASE("Testing arena stats") {
+    MY_ALLOC_ARENA_STATS stats;
+    size_t heapSize = 0, usedSize = 0, requests = 0;
+    unsigned int arena;
+    char *p1;
+    
+    SECTION("Occupancy") {
+        INFO("Arenas must partition the heap and account used blocks") // Only appears on a FAIL
+        p1 = (char*) myMalloc(50);
+        REQUIRE(p1 != NULL);
+        for (arena = 0; MyAlloc_GetArenaStats(arena, &stats); arena++) {
+            REQUIRE(stats.usedSize + stats.freeSize == stats.heapSize);
+            REQUIRE(stats.largestFree < stats.freeSize);
+            REQUIRE(stats.usedSize <= stats.committedSize);
+            REQUIRE(stats.committedSize <= stats.heapSize);
+            heapSize += stats.heapSize;
+            usedSize += stats.usedSize;
+            requests += stats.requests;
+        }
+        REQUIRE(arena == MY_ALLOC_ARENAS);
+        REQUIRE(heapSize == MAX_HEAP_SIZE);
+        REQUIRE_CHAIN_SPACE(usedSize == MyAlloc_GetTotalSize(p1));
+        REQUIRE_CHAIN_SPACE(requests == 1);
+        myFree(p1);
+#if defined MY_ALLOC_USE_THREAD_CACHE
+        MyAlloc_FlushThreadCache(); // Stats account cached blocks as used
+#endif
+        for (arena = 0; MyAlloc_GetArenaStats(arena, &stats); arena++)
+            REQUIRE(stats.usedSize == 0);
+    }
+}
+
+#if defined MY_ALLOC_USE_MMAP
+// True if the arena that owns ptr has committed the size bytes from ptr on
+static bool committedAfter(void* ptr, size_t size) {
+    MY_ALLOC_ARENA_STATS stats;
+    unsigned int arena;
+    
+    for (arena = 0; MyAlloc_GetArenaStats(arena, &stats); arena++)
+        if ((size_t) ptr >= stats.heapStartAddress && (size_t) ptr < stats.heapStartAddress + stats.heapSize)
+            return stats.committedSize >= (size_t) ptr + size - stats.heapStartAddress && stats.committedSize <= stats.heapSize;
+    return false;
+}
+
+TEST_CASE("Testing mmap heap") {
+    MY_ALLOC_ARENA_STATS stats;
+    size_t size;
+    char *p1, *p2;
+    
+    REQUIRE(MyAlloc_GetArenaStats(0, &stats));
+    size = LARGE_REQUEST(stats.heapSize, 1, 2);
+    
+    SECTION("Commit on demand") {
+        INFO("The pages of a block must be committed before it is handed out") // Only appears on a FAIL
+        p1 = (char*) myMalloc(size);
+        REQUIRE(p1 != NULL);
+        memset(p1, 0x5A, size); // Faults if a page is still reserved only
+        REQUIRE(committedAfter(p1, size));
+        myFree(p1);
+    }
+    
+    SECTION("Growth in place") {
+        INFO("Growing a block must commit the absorbed space") // Only appears on a FAIL
+        p1 = (char*) myMalloc(size / 4);
+        REQUIRE(p1 != NULL);
+        p2 = (char*) myRealloc(p1, size);
+        REQUIRE(p2 != NULL);
+        memset(p2, 0xA5, size);
+        REQUIRE(committedAfter(p2, size));
+        myFree(p2);
+    }
+    
+    SECTION("Zero filled tail") {
+        INFO("Fresh pages read as zero, calloc must still return zeroed memory") // Only appears on a FAIL
+        p1 = (char*) myCalloc(1, size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(std::all_of(p1, p1 + size, [](char c) { return c == 0; }));
+        myFree(p1);
+    }
+}
+#endif
+
+#if defined MY_ALLOC_USE_PURGE
+TEST_CASE("Testing purge") {
+    MY_ALLOC_ARENA_STATS stats;
+    size_t size, purged;
+    char *p1, *p2;
+    
+    REQUIRE(MyAlloc_GetArenaStats(0, &stats));
+    size = LARGE_REQUEST(stats.heapSize, 1, 4);
+    
+    SECTION("Released pages") {
+        INFO("The pages of free blocks must be released once and read as zero") // Only appears on a FAIL
+        p1 = (char*) myMalloc(size);
+        p2 = (char*) myMalloc(64);
+        REQUIRE(p1 != NULL);
+        REQUIRE(p2 != NULL);
+        memset(p1, 0x5A, size);
+        memset(p2, 0xA5, 64);
+        myFree(p1);
+        purged = MyAlloc_Purge();
+        if (size >= 4 * (size_t) sysconf(_SC_PAGESIZE))
+            REQUIRE(purged > 0);
+        // Purged blocks are zero filled and skipped by the next pass
+        REQUIRE(MyAlloc_Purge() == 0);
+        p1 = (char*) myCalloc(1, size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(std::all_of(p1, p1 + size, [](char c) { return c == 0; }));
+        // Used blocks keep their content
+        REQUIRE(std::all_of(p2, p2 + 64, [](char c) { return c == (char) 0xA5; }));
+        myFree(p1);
+        myFree(p2);
+    }
+    
+    SECTION("Reuse after purge") {
+        INFO("A purged block merged with a dirty one must be purged again") // Only appears on a FAIL
+        p1 = (char*) myMalloc(size);
+        p2 = (char*) myMalloc(size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(p2 != NULL);
+        memset(p1, 0x5A, size);
+        memset(p2, 0x5A, size);
+        myFree(p1);
+        MyAlloc_Purge();
+        myFree(p2);
+        purged = MyAlloc_Purge();
+        if (size >= 4 * (size_t) sysconf(_SC_PAGESIZE))
+            REQUIRE(purged > 0);
+        p1 = (char*) myCalloc(2, size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(std::all_of(p1, p1 + 2 * size, [](char c) { return c == 0; }));
+        myFree(p1);
+    }
+}
+#endif
+
+#if defined MY_ALLOC_USE_HUGE_PAGES
+TEST_CASE("Testing huge pages") {
+    MY_ALLOC_ARENA_STATS stats;
+    
+    SECTION("Heap alignment") {
+        INFO("The default heap must start on a huge page boundary") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetArenaStats(0, &stats));
+        REQUIRE((stats.heapStartAddress - METADATA_T_OFFSET) % MY_ALLOC_HUGE_PAGE_SIZE == 0);
+    }
+}
+#endif
+
+#define INSTANCE_SIZE   32768 // Room for the TLSF descriptor too
+TEST_CASE("Testing heap instances") {
+    static uint64_t region1[INSTANCE_SIZE / sizeof(uint64_t)], region2[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC *h1, *h2;
+    char *p1, *p2;
+    
+    SECTION("Independent instances") {
+        INFO("Each instance must allocate from its own region") // Only appears on a FAIL
+        h1 = MyAlloc_Create(region1, sizeof(region1), NULL);
+        h2 = MyAlloc_Create(region2, sizeof(region2), &config);
+        REQUIRE(h1 != NULL);
+        REQUIRE(h2 != NULL);
+        p1 = (char*) MyAlloc_MallocFrom(h1, 100);
+        p2 = (char*) MyAlloc_MallocFrom(h2, 200);
+        REQUIRE((p1 > (char*) region1 && p1 < (char*) region1 + sizeof(region1)));
+        REQUIRE((p2 > (char*) region2 && p2 < (char*) region2 + sizeof(region2)));
+        REQUIRE_REQUESTED_SIZE(p1, 100);
+        // Pointers of other heaps are ignored
+        MyAlloc_FreeTo(h1, p2);
+        myFree(p1);
+        REQUIRE(MyAlloc_GetHeapStats(h1, &stats));
+        REQUIRE(stats.requests == 1);
+        MyAlloc_FreeTo(h1, p1);
+        MyAlloc_FreeTo(h2, p2);
+        REQUIRE(MyAlloc_GetHeapStats(h1, &stats));
+        REQUIRE(stats.requests == 0);
+        REQUIRE(stats.usedSize == 0);
+        REQUIRE(stats.committedSize == stats.heapSize);
+        // The instance is larger than the default heap when DDR_SIZE is small
+        p1 = (char*) MyAlloc_MallocFrom(h2, LARGE_REQUEST(stats.heapSize, 1, 2));
+        REQUIRE(p1 != NULL);
+        MyAlloc_FreeTo(h2, p1);
+        MyAlloc_Destroy(h1);
+        MyAlloc_Destroy(h2);
+    }
+    
+    SECTION("Destroyed instance") {
+        INFO("A destroyed instance must not hand out its region anymore") // Only appears on a FAIL
+        h1 = MyAlloc_Create(region1, sizeof(region1), NULL);
+        REQUIRE(h1 != NULL);
+        p1 = (char*) MyAlloc_MallocFrom(h1, 100);
+        REQUIRE(p1 != NULL);
+        MyAlloc_Destroy(h1);
+        REQUIRE(MyAlloc_MallocFrom(h1, 100) == NULL);
+        REQUIRE(MyAlloc_CallocFrom(h1, 10, 10) == NULL);
+        REQUIRE(MyAlloc_ReallocFrom(h1, NULL, 100) == NULL);
+        REQUIRE(MyAlloc_ReallocFrom(h1, p1, 200) == NULL);
+        REQUIRE(MyAlloc_AlignedAllocFrom(h1, 64, 100) == NULL);
+        REQUIRE_FALSE(MyAlloc_GetHeapStats(h1, &stats));
+        MyAlloc_FreeTo(h1, p1);
+    }
+    
+    SECTION("Region too small") {
+        INFO("A region that cannot hold a block must be rejected") // Only appears on a FAIL
+        REQUIRE(MyAlloc_Create(region1, sizeof(MY_ALLOC), NULL) == NULL);
+        REQUIRE(MyAlloc_Create(NULL, INSTANCE_SIZE, NULL) == NULL);
+    }
+}
+
+TEST_CASE("Testing realloc") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    char *p1, *p2, *p3;
+    int i;
+    
+    REQUIRE(h != NULL);
+    
+    SECTION("In place growth and shrinking") {
+        INFO("A block followed by free space must not move") // Only appears on a FAIL
+        p1 = (char*) MyAlloc_MallocFrom(h, 64);
+        for (i = 0; i < 64; i++)
+            p1[i] = (char) i;
+        p2 = (char*) MyAlloc_ReallocFrom(h, p1, 1000);
+#if defined USE_BUDDY
+        // A buddy block grows in place only when it is followed by its free buddies, see "Testing buddy system"
+        p1 = p2;
+#endif
+        REQUIRE(p2 == p1);
+        REQUIRE_REQUESTED_SIZE(p2, 1000);
+        p2 = (char*) MyAlloc_ReallocFrom(h, p2, 16);
+        REQUIRE(p2 == p1);
+        for (i = 0; i < 16; i++)
+            REQUIRE(p2[i] == (char) i);
+        // The released tail is reusable
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.requests == 1);
+        MyAlloc_FreeTo(h, p2);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+    }
+    
+    SECTION("Move when the neighbour is used") {
+        INFO("A block that cannot grow must be copied") // Only appears on a FAIL
+        p1 = (char*) MyAlloc_MallocFrom(h, 64);
+        p2 = (char*) MyAlloc_MallocFrom(h, 64);
+        for (i = 0; i < 64; i++)
+            p1[i] = (char) i;
+        p3 = (char*) MyAlloc_ReallocFrom(h, p1, 512);
+        REQUIRE(p3 != NULL);
+        REQUIRE(p3 != p1);
+        for (i = 0; i < 64; i++)
+            REQUIRE(p3[i] == (char) i);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.requests == 2);
+        // Requests that cannot be satisfied leave the block untouched
+        REQUIRE(MyAlloc_ReallocFrom(h, p3, INSTANCE_SIZE) == NULL);
+        REQUIRE_REQUESTED_SIZE(p3, 512);
+        MyAlloc_FreeTo(h, p2);
+        MyAlloc_FreeTo(h, p3);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+    }
+    
+    SECTION("Null pointer and zero size") {
+        INFO("myRealloc must behave as myMalloc and myFree") // Only appears on a FAIL
+        p1 = (char*) myRealloc(NULL, 100);
+        REQUIRE(p1 != NULL);
+        p1 = (char*) myRealloc(p1, 200);
+        REQUIRE(p1 != NULL);
+        REQUIRE_REQUESTED_SIZE(p1, 200);
+        REQUIRE(myRealloc(p1, 0) == NULL);
+        REQUIRE(MyAlloc_ReallocFrom(h, NULL, 0) == NULL);
+    }
+    
+    MyAlloc_Destroy(h);
+}
+
+TEST_CASE("Testing calloc") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false, false };
+    MY_ALLOC* h;
+    char *p1, *p2;
+    size_t i;
+    
+    SECTION("Dirty blocks are cleared") {
+        INFO("Released content must not leak into myCalloc") // Only appears on a FAIL
+        p1 = (char*) myMalloc(300);
+        memset(p1, 0xA5, 300);
+        myFree(p1);
+        p2 = (char*) myCalloc(3, 100);
+        REQUIRE(p2 != NULL);
+        for (i = 0; i < 300; i++)
+            REQUIRE(p2[i] == 0);
+        myFree(p2);
+        REQUIRE(myCalloc(((size_t) -1) / 2, 4) == NULL);
+    }
+    
+    SECTION("Zeroed and dirty instances") {
+        INFO("Both instance kinds must return zero filled blocks") // Only appears on a FAIL
+        memset(region, 0xA5, sizeof(region));
+        h = MyAlloc_Create(region, sizeof(region), &config);
+        REQUIRE(h != NULL);
+        p1 = (char*) MyAlloc_CallocFrom(h, 1, 1000);
+        for (i = 0; i < 1000; i++)
+            REQUIRE(p1[i] == 0);
+        MyAlloc_Destroy(h);
+        
+        memset(region, 0, sizeof(region));
+        config.zeroed = true;
+        h = MyAlloc_Create(region, sizeof(region), &config);
+        p1 = (char*) MyAlloc_CallocFrom(h, 1, 1000);
+        p2 = (char*) MyAlloc_CallocFrom(h, 1, 1000);
+        memset(p1, 0xA5, 1000);
+        MyAlloc_FreeTo(h, p1);
+        // Reuses the dirty space of p1
+        p1 = (char*) MyAlloc_CallocFrom(h, 10, 100);
+        for (i = 0; i < 1000; i++) {
+            REQUIRE(p1[i] == 0);
+            REQUIRE(p2[i] == 0);
+        }
+        MyAlloc_FreeTo(h, p1);
+        MyAlloc_FreeTo(h, p2);
+        MyAlloc_Destroy(h);
+    }
+}
+
+TEST_CASE("Testing aligned allocation") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false, false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    char *p[8], *q;
+    size_t alignment;
+    int i;
+    
+    REQUIRE(h != NULL);
+    
+    SECTION("Payload on the boundary") {
+        INFO("Every power of two alignment must be honoured") // Only appears on a FAIL
+        for (i = 0, alignment = 8; i < 8; i++, alignment *= 2) {
+            p[i] = (char*) MyAlloc_AlignedAllocFrom(h, alignment, 40);
+            REQUIRE(p[i] != NULL);
+            REQUIRE(((size_t) p[i] & (alignment - 1)) == 0);
+            memset(p[i], i, 40);
+        }
+        for (i = 0; i < 8; i++)
+            REQUIRE(p[i][39] == i);
+        REQUIRE(MyAlloc_AlignedAllocFrom(h, 24, 40) == NULL);
+        REQUIRE(MyAlloc_AlignedAllocFrom(h, 0, 40) == NULL);
+#if !defined USE_BUDDY
+        // The leading slack is reused by small blocks
+        q = (char*) MyAlloc_MallocFrom(h, 8);
+        REQUIRE(q < p[7]);
+        MyAlloc_FreeTo(h, q);
+#endif
+        for (i = 0; i < 8; i++)
+            MyAlloc_FreeTo(h, p[i]);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+        REQUIRE(MyAlloc_MallocFrom(h, LARGE_REQUEST(stats.heapSize, 3, 4)) != NULL);
+    }
+    
+    SECTION("Default heap") {
+        INFO("myFree must release aligned blocks") // Only appears on a FAIL
+        q = (char*) myAlignedAlloc(64, 100);
+        REQUIRE(q != NULL);
+        REQUIRE(((size_t) q & 63) == 0);
+        myFree(q);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+    
+    MyAlloc_Destroy(h);
+}
+
+#if defined USE_BUDDY
+TEST_CASE("Testing buddy system") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    std::vector<char*> blocks;
+    std::vector<char*>::iterator buddy;
+    char *p, *q;
+    size_t size, count, i;
+    
+    REQUIRE(h != NULL);
+    
+    SECTION("Natural alignment") {
+        INFO("A block is aligned to its power-of-two size") // Only appears on a FAIL
+        for (size = 256; size <= 4096; size *= 2) {
+            p = (char*) MyAlloc_MallocFrom(h, size - METADATA_T_ALIGNED);
+            REQUIRE(p != NULL);
+            REQUIRE(((size_t) p & (size - 1)) == 0);
+            blocks.push_back(p);
+        }
+        for (i = 0; i < blocks.size(); i++)
+            MyAlloc_FreeTo(h, blocks[i]);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+    }
+    
+    SECTION("Split and merge") {
+        INFO("Released buddies must merge back and a block must grow into its free buddy") // Only appears on a FAIL
+        size = 256 - METADATA_T_ALIGNED;
+        while ((p = (char*) MyAlloc_MallocFrom(h, size)) != NULL)
+            blocks.push_back(p);
+        REQUIRE(blocks.size() > 2);
+        count = blocks.size();
+        // Grow a left buddy in place once its right buddy is released
+        for (i = 0; i < count; i++) {
+            buddy = std::find(blocks.begin(), blocks.end(), blocks[i] + 256);
+            if (((size_t) blocks[i] & 256) == 0 && buddy != blocks.end())
+                break;
+        }
+        REQUIRE(i < count);
+        p = blocks[i];
+        REQUIRE(MyAlloc_ReallocFrom(h, p, 2 * size) == NULL);
+        MyAlloc_FreeTo(h, *buddy);
+        blocks.erase(buddy);
+        q = (char*) MyAlloc_ReallocFrom(h, p, 2 * size);
+        REQUIRE(q == p);
+        // Every block merges with its buddy, the whole region is available again
+        for (i = 0; i < blocks.size(); i++)
+            MyAlloc_FreeTo(h, blocks[i]);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+        for (i = 0; i < count; i++)
+            REQUIRE(MyAlloc_MallocFrom(h, size) != NULL);
+    }
+    
+    MyAlloc_Destroy(h);
+}
+#endif
+
+#if defined MY_ALLOC_USE_FREE_TREE
+TEST_CASE("Testing free tree") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    static char* blocks[INSTANCE_SIZE / 64];
+    size_t sizes[] = { 256, 64, 128, 64 };
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    char *hole[4], *p;
+    size_t largest;
+    uint32_t seed = 12345;
+    int i, count;
+    
+    REQUIRE(h != NULL);
+    SECTION("Fit queries") {
+        INFO("Best-fit must take the tightest hole, first-fit the lowest fitting address") // Only appears on a FAIL
+        // Holes separated by used blocks, the tail of the region is the largest free block
+        for (i = 0; i < 4; i++) {
+            hole[i] = (char*) MyAlloc_MallocFrom(h, sizes[i]);
+            REQUIRE(MyAlloc_MallocFrom(h, 16) != NULL);
+        }
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        largest = stats.largestFree;
+        for (i = 0; i < 4; i++)
+            MyAlloc_FreeTo(h, hole[i]);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.largestFree == largest);
+        p = (char*) MyAlloc_MallocFrom(h, 64);
+#if defined USE_FIRST_FIT
+        REQUIRE(p == hole[0]);
+        // The rest of the first hole is still the lowest fitting address
+        p = (char*) MyAlloc_MallocFrom(h, 100);
+        REQUIRE((p > hole[0] && p < hole[1]));
+#else
+        REQUIRE(p == hole[1]); // Equal sizes are ordered by address
+        p = (char*) MyAlloc_MallocFrom(h, 100);
+        REQUIRE(p == hole[2]);
+#endif
+    }
+    
+    SECTION("Random release order") {
+        INFO("Coalescing must keep the tree consistent") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        largest = stats.largestFree;
+        for (count = 0; (blocks[count] = (char*) MyAlloc_MallocFrom(h, 16 + (seed = seed * 1103515245 + 12345) % 96)) != NULL; count++)
+            ;
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.largestFree < 16 + 96); // Smaller than the request that failed
+        std::shuffle(blocks, blocks + count, std::minstd_rand(seed));
+        for (i = 0; i < count; i++) {
+            MyAlloc_FreeTo(h, blocks[i]);
+            // Allocations in between take nodes out of the tree while it is being rebuilt
+            if (i % 16 == 0) {
+                p = (char*) MyAlloc_MallocFrom(h, 16);
+                REQUIRE(p != NULL);
+                MyAlloc_FreeTo(h, p);
+            }
+        }
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+        REQUIRE(stats.largestFree == largest);
+    }
+    
+    MyAlloc_Destroy(h);
+}
+#endif
+
+TEST_CASE("Testing header layout") {
+    char *p[4];
+    int i;
+    
+    SECTION("Default alignment") {
+        INFO("Payloads must be aligned to ALIGNMENT") // Only appears on a FAIL
+        for (i = 0; i < 4; i++) {
+            p[i] = (char*) myMalloc((size_t) 1 + i * 7);
+            REQUIRE(((size_t) p[i] & (ALIGNMENT - 1)) == 0);
+        }
+        for (i = 0; i < 4; i++)
+            myFree(p[i]);
+    }
+    
+#if defined MY_ALLOC_BOUNDARY_TAGS && !defined USE_BUDDY // Buddy blocks are not packed, see "Testing buddy system"
+    SECTION("Boundary tags") {
+        INFO("Used blocks carry one word and free neighbours merge in both directions") // Only appears on a FAIL
+        REQUIRE(METADATA_T_ALIGNED == WORD_SIZE);
+        for (i = 0; i < 4; i++)
+            p[i] = (char*) myMalloc(40);
+        REQUIRE(p[1] - p[0] == (long) (ALIGN(40 + METADATA_T_ALIGNED)));
+        myFree(p[0]);
+        myFree(p[2]);
+        // The footer of p[0] and the header of p[2] let p[1] join both neighbours
+        myFree(p[1]);
+#if defined MY_ALLOC_USE_THREAD_CACHE
+        MyAlloc_FlushThreadCache();
+#endif
+        p[0] = (char*) myMalloc(3 * ALIGN(40 + METADATA_T_ALIGNED) - METADATA_T_ALIGNED);
+        REQUIRE(p[0] < p[3]);
+        myFree(p[0]);
+        myFree(p[3]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+#endif
+    
+#if defined MY_ALLOC_HEADER_64 && defined __unix__
+    SECTION("Regions larger than 2 GBytes") {
+        INFO("The 64-bit header must hold sizes above 32 bits") // Only appears on a FAIL
+#if defined USE_BUDDY
+        size_t size = (size_t) 9 << 30; // Room for a 4 GBytes block aligned to its size
+#else
+        size_t size = (size_t) 5 << 30;
+#endif
+        void* region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (region != MAP_FAILED) {
+            MY_ALLOC_CONFIG config = { false, true };
+            MY_ALLOC_ARENA_STATS stats;
+            MY_ALLOC* h = MyAlloc_Create(region, size, &config);
+            REQUIRE(h != NULL);
+            // Only the headers are touched, the pages are never committed
+            p[0] = (char*) MyAlloc_MallocFrom(h, (size_t) 3 << 30);
+            p[1] = (char*) MyAlloc_MallocFrom(h, (size_t) 1 << 30);
+            REQUIRE(p[0] != NULL);
+            REQUIRE(p[1] != NULL);
+            REQUIRE_REQUESTED_SIZE(p[0], ((size_t) 3 << 30));
+            REQUIRE((p[1] >= p[0] + ((size_t) 3 << 30) || p[0] >= p[1] + ((size_t) 1 << 30)));
+            MyAlloc_FreeTo(h, p[0]);
+            MyAlloc_FreeTo(h, p[1]);
+            REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+            REQUIRE(stats.usedSize == 0);
+            MyAlloc_Destroy(h);
+            munmap(region, size);
+        }
+    }
+#endif
+}
+
+#if defined MY_ALLOC_USE_SLABS
+#define SLAB_OBJECTS    64
+TEST_CASE("Testing slabs") {
+    char *p[SLAB_OBJECTS], *q;
+    int i;
+    
+    if (MAX_HEAP_SIZE / MY_ALLOC_ARENAS < 2 * SLAB_PAGE_SIZE)
+        return; // The heap cannot hold slab pages, small requests use the block chain
+    
+    SECTION("Headerless slots") {
+        INFO("Objects of a class must be packed in the same page") // Only appears on a FAIL
+        for (i = 0; i < SLAB_OBJECTS; i++) {
+            p[i] = (char*) myMalloc(48);
+            REQUIRE(p[i] != NULL);
+            REQUIRE(MyAlloc_GetRequestedSize(p[i]) == ALIGN(48));
+            memset(p[i], i, 48);
+        }
+        REQUIRE(((size_t) p[0] & ~((size_t) SLAB_PAGE_SIZE - 1)) == ((size_t) p[1] & ~((size_t) SLAB_PAGE_SIZE - 1)));
+        REQUIRE(p[1] - p[0] == (long) ALIGN(48));
+        for (i = 0; i < SLAB_OBJECTS; i++)
+            REQUIRE(p[i][47] == (char) i);
+        // A released slot is handed out again
+        myFree(p[5]);
+        q = (char*) myMalloc(48);
+        REQUIRE(q == p[5]);
+        myFree(q);
+        for (i = 0; i < SLAB_OBJECTS; i++)
+            if (i != 5)
+                myFree(p[i]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+    
+    SECTION("Realloc and calloc of slots") {
+        INFO("Slots must move to the block chain when they outgrow their class") // Only appears on a FAIL
+        p[0] = (char*) myMalloc(24);
+        memset(p[0], 0x5A, 24);
+        REQUIRE(myRealloc(p[0], 20) == p[0]);
+        q = (char*) myRealloc(p[0], SLAB_MAX_SIZE * 2);
+        REQUIRE(q != NULL);
+        for (i = 0; i < 20; i++)
+            REQUIRE(q[i] == 0x5A);
+        myFree(q);
+        p[0] = (char*) myMalloc(64);
+        memset(p[0], 0x5A, 64);
+        myFree(p[0]);
+        p[0] = (char*) myCalloc(8, 8);
+        for (i = 0; i < 64; i++)
+            REQUIRE(p[0][i] == 0);
+        myFree(p[0]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+#endif
+
+#if defined USE_BUDDY
+#define ARENA_OBJECTS   8
+#define ARENA_CHUNK     (128 - METADATA_T_ALIGNED) // Chunks fill a buddy block
+#else
+#define ARENA_OBJECTS   16
+#define ARENA_CHUNK     128
+#endif
+TEST_CASE("Testing arenas") {
+    char *p[ARENA_OBJECTS];
+    MY_ARENA_MARKER outer, inner;
+    int i, j;
+    
+    SECTION("Bump allocation and reset") {
+        INFO("Objects must be disjoint and aligned, reset must release every chunk but the first") // Only appears on a FAIL
+        MY_ARENA* arena = MyArena_Create(NULL, ARENA_CHUNK);
+        REQUIRE(arena != NULL);
+        size_t space = MyAlloc_GetFreeNonLinearSpace();
+        for (i = 0; i < ARENA_OBJECTS; i++) {
+            p[i] = (char*) MyArena_Alloc(arena, (size_t) 1 + i);
+            REQUIRE(p[i] != NULL);
+            REQUIRE(((size_t) p[i] & (ALIGNMENT - 1)) == 0);
+            memset(p[i], i, (size_t) 1 + i);
+        }
+        // Consecutive objects of a chunk are packed
+        REQUIRE(p[1] - p[0] == (long) ALIGN(1));
+        for (i = 0; i < ARENA_OBJECTS; i++)
+            for (j = 0; j <= i; j++)
+                REQUIRE(p[i][j] == (char) i);
+        // Requests larger than a chunk get a chunk of their own
+        REQUIRE(MyArena_Alloc(arena, ARENA_CHUNK) != NULL);
+        REQUIRE(MyArena_Alloc(arena, 0) == NULL);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() < space);
+        MyArena_Reset(arena);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == space);
+        REQUIRE(MyArena_Alloc(arena, 1) == p[0]);
+        MyArena_Destroy(arena);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+    
+    SECTION("Nested markers") {
+        INFO("Restoring a marker must rewind the arena and release the chunks taken after it") // Only appears on a FAIL
+        MY_ARENA* arena = MyArena_Create(NULL, ARENA_CHUNK);
+        REQUIRE(arena != NULL);
+        p[0] = (char*) MyArena_Alloc(arena, 16);
+        outer = MyArena_Save(arena);
+        size_t space = MyAlloc_GetFreeNonLinearSpace();
+        p[1] = (char*) MyArena_Alloc(arena, 16);
+        inner = MyArena_Save(arena);
+        for (i = 2; i < ARENA_OBJECTS / 2; i++)
+            p[i] = (char*) MyArena_Alloc(arena, 32);
+        MyArena_Restore(arena, inner);
+        REQUIRE(MyArena_Alloc(arena, 32) == p[2]);
+        MyArena_Restore(arena, outer);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == space);
+        REQUIRE(MyArena_Alloc(arena, 16) == p[1]);
+        MyArena_Destroy(arena);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+    
+    SECTION("Heap instances") {
+        INFO("Chunks must be taken from the given heap") // Only appears on a FAIL
+        static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+        MY_ALLOC_CONFIG config = { false };
+        MY_ALLOC_ARENA_STATS stats;
+        MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+        MY_ARENA* arena = MyArena_Create(h, ARENA_CHUNK);
+        REQUIRE(arena != NULL);
+        REQUIRE((char*) arena > (char*) region);
+        REQUIRE((char*) arena < (char*) region + sizeof(region));
+        while (MyArena_Alloc(arena, 48) != NULL)
+            ;
+        MyArena_Destroy(arena);
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+        MyAlloc_Destroy(h);
+    }
+}
+
+TEST_CASE("Testing C++ adapters") {
+    static uint64_t region[INSTANCE_SIZE / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    int i;
+    
+    REQUIRE(h != NULL);
+    SECTION("Memory resource") {
+        INFO("Containers must draw from the given heap and honour alignment") // Only appears on a FAIL
+        MyAllocResource resource(h), same(h), other;
+        {
+            std::pmr::vector<int> v(&resource);
+            std::pmr::unordered_map<int, std::pmr::string> m(&resource);
+            for (i = 0; i < 64; i++) {
+                v.push_back(i);
+                m.emplace(i, std::pmr::string(40, (char) ('a' + i % 26)));
+            }
+            REQUIRE(((char*) v.data() > (char*) region && (char*) v.data() < (char*) region + sizeof(region)));
+            REQUIRE(m.at(63).compare(std::string(40, (char) ('a' + 63 % 26)).c_str()) == 0);
+            void* p = resource.allocate(100, 128);
+            REQUIRE(((size_t) p & 127) == 0);
+            same.deallocate(p, 100, 128);
+            REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+            REQUIRE(stats.usedSize > 0);
+        }
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        REQUIRE(stats.usedSize == 0);
+        REQUIRE(resource == same);
+        REQUIRE(resource != other);
+        REQUIRE_THROWS_AS(resource.allocate(sizeof(region)), std::bad_alloc);
+    }
+    
+    SECTION("Allocator") {
+        INFO("Classic containers must draw from the default heap") // Only appears on a FAIL
+        {
+            std::vector<int, MyAllocator<int> > v(16, 7);
+            std::basic_string<char, std::char_traits<char>, MyAllocator<char> > str(64, 'x');
+            REQUIRE(MyAlloc_GetRequestedSize(v.data()) >= 16 * sizeof(int));
+            REQUIRE(MyAlloc_GetRequestedSize(&str[0]) >= 64);
+            REQUIRE(v == std::vector<int, MyAllocator<int> >(16, 7));
+            REQUIRE(MyAllocator<int>() == MyAllocator<char>());
+        }
+#if defined MY_ALLOC_USE_THREAD_CACHE
+        MyAlloc_FlushThreadCache();
+#endif
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+        REQUIRE_THROWS_AS(MyAllocator<int>().allocate(MAX_HEAP_SIZE), std::bad_alloc);
+    }
+    
+    MyAlloc_Destroy(h);
+}
+
+#define GROWTH_STEPS    10
+TEST_CASE("Benchmark small object density", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 8) / sizeof(uint64_t)];
+    static void* objects[INSTANCE_SIZE * 8 / 16];
+    MY_ALLOC_CONFIG config = { false, false };
+    size_t size, count, i;
+    
+    // Fill the region with small objects, then walk them as a linked structure would
+    printf("Header size: %lu bytes\r\n", (unsigned long) METADATA_T_ALIGNED);
+    printf("Object | Objects | Bytes/object | Walk (ns/object)\r\n");
+    for (size = 8; size <= 64; size += 8) {
+        MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+        for (count = 0; (objects[count] = MyAlloc_MallocFrom(h, size)) != NULL; count++)
+            memset(objects[count], (int) count, size);
+        auto start = std::chrono::steady_clock::now();
+        volatile size_t sum = 0;
+        for (i = 0; i < count; i++)
+            sum = sum + *(char*) objects[i];
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%6lu | %7lu | %12.1f | %16.2f\r\n", (unsigned long) size, (unsigned long) count,
+               (double) sizeof(region) / count, seconds * 1e9 / count);
+        MyAlloc_Destroy(h);
+    }
+}
+
+#define SMALL_BATCH     256
+#define SMALL_ROUNDS    200
+TEST_CASE("Benchmark small size classes", "[.][benchmark]") {
+    static void* objects[SMALL_BATCH];
+    size_t sizes[] = { 24, 48, 64, 128 };
+    int round, i;
+    unsigned int s;
+    
+    // Batches of allocations of the hot struct sizes, released in the same order
+    printf("Size | malloc+free (ns)\r\n");
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        auto start = std::chrono::steady_clock::now();
+        for (round = 0; round < SMALL_ROUNDS; round++) {
+            for (i = 0; i < SMALL_BATCH; i++)
+                objects[i] = myMalloc(sizes[s]);
+            for (i = 0; i < SMALL_BATCH; i++)
+                myFree(objects[i]);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%4lu | %16.1f\r\n", (unsigned long) sizes[s], seconds * 1e9 / (SMALL_ROUNDS * SMALL_BATCH));
+    }
+    REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+}
+
+#define ARENA_REQUESTS  1000
+TEST_CASE("Benchmark request lifetime", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 8) / sizeof(uint64_t)];
+    static void* objects[SMALL_BATCH];
+    size_t sizes[] = { 24, 48, 64, 128 };
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    MY_ARENA* arena = MyArena_Create(h, 0);
+    int request, i;
+    
+    // A request allocates a batch of short-lived objects and releases them all at its end
+    REQUIRE(arena != NULL);
+    BENCHMARK("Request with malloc and free") {
+        for (request = 0; request < ARENA_REQUESTS; request++) {
+            for (i = 0; i < SMALL_BATCH; i++)
+                objects[i] = MyAlloc_MallocFrom(h, sizes[i % 4]);
+            for (i = 0; i < SMALL_BATCH; i++)
+                MyAlloc_FreeTo(h, objects[i]);
+        }
+    }
+    BENCHMARK("Request with arena and reset") {
+        for (request = 0; request < ARENA_REQUESTS; request++) {
+            for (i = 0; i < SMALL_BATCH; i++)
+                objects[i] = MyArena_Alloc(arena, sizes[i % 4]);
+            MyArena_Reset(arena);
+        }
+    }
+    MyArena_Destroy(arena);
+    MyAlloc_Destroy(h);
+}
+
+#define CONTAINER_SIZE  10000
+template <typename Vector, typename Map, typename String>
+static size_t containerWorkload(typename Vector::allocator_type vectorAllocator, typename Map::allocator_type mapAllocator,
+                                typename String::allocator_type stringAllocator) {
+    Vector v(vectorAllocator);
+    Map m(mapAllocator);
+    size_t sum = 0;
+    int i;
+    
+    // Growing vector, node based map of strings, then a walk over both
+    for (i = 0; i < CONTAINER_SIZE; i++) {
+        v.push_back(i);
+        m.emplace(i, String("value of a map entry", stringAllocator));
+    }
+    for (i = 0; i < CONTAINER_SIZE; i++)
+        sum += (size_t) v[i] + m.find(i)->second.size();
+    return sum;
+}
+
+TEST_CASE("Benchmark containers", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 256) / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    MyAllocResource resource(h);
+    
+    REQUIRE(h != NULL);
+    // The first run pays the page faults of the fresh region
+    containerWorkload<std::vector<int>, std::unordered_map<int, std::string>, std::string>({}, {}, {});
+    containerWorkload<std::pmr::vector<int>, std::pmr::unordered_map<int, std::pmr::string>, std::pmr::string>(&resource, &resource, &resource);
+    BENCHMARK("std::allocator") {
+        containerWorkload<std::vector<int>, std::unordered_map<int, std::string>, std::string>({}, {}, {});
+    }
+    BENCHMARK("MyAllocResource on a heap instance") {
+        containerWorkload<std::pmr::vector<int>, std::pmr::unordered_map<int, std::pmr::string>, std::pmr::string>(&resource, &resource, &resource);
+    }
+#if MAX_HEAP_SIZE >= 4 * 1024 * 1024
+    typedef std::unordered_map<int, std::string, std::hash<int>, std::equal_to<int>, MyAllocator<std::pair<const int, std::string> > > MyAllocatorMap;
+    containerWorkload<std::vector<int, MyAllocator<int> >, MyAllocatorMap, std::string>({}, {}, {});
+    BENCHMARK("MyAllocator on the default heap") {
+        containerWorkload<std::vector<int, MyAllocator<int> >, MyAllocatorMap, std::string>({}, {}, {});
+    }
+#endif
+    MyAlloc_Destroy(h);
+}
+
+#define CALLOC_ROUNDS   100
+TEST_CASE("Benchmark calloc of fresh memory", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 8) / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false, false };
+    double seconds[2] = { 0, 0 };
+    int round, zeroed;
+    
+    // Only the calloc is timed, the region is prepared as fresh memory every round
+    for (round = 0; round < CALLOC_ROUNDS; round++) {
+        for (zeroed = 0; zeroed < 2; zeroed++) {
+            memset(region, 0, sizeof(region));
+            config.zeroed = zeroed;
+            MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+            auto start = std::chrono::steady_clock::now();
+            char* p = (char*) MyAlloc_CallocFrom(h, 1, INSTANCE_SIZE * 4);
+            seconds[zeroed] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            REQUIRE(p != NULL);
+            MyAlloc_Destroy(h);
+        }
+    }
+    printf("Region  | Calloc time (ns)\r\n");
+    printf("Dirty   | %16.0f\r\n", seconds[0] * 1e9 / CALLOC_ROUNDS);
+    printf("Zeroed  | %16.0f\r\n", seconds[1] * 1e9 / CALLOC_ROUNDS);
+}
+
+TEST_CASE("Benchmark realloc growth", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 8) / sizeof(uint64_t)];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    
+    REQUIRE(h != NULL);
+    // A vector doubling its capacity: realloc against malloc, copy and free
+    BENCHMARK("Growth with realloc") {
+        char* p = (char*) MyAlloc_MallocFrom(h, 64);
+        for (int i = 1; i <= GROWTH_STEPS; i++)
+            p = (char*) MyAlloc_ReallocFrom(h, p, (size_t) 64 << i);
+        MyAlloc_FreeTo(h, p);
+    }
+    BENCHMARK("Growth with malloc and copy") {
+        char* p = (char*) MyAlloc_MallocFrom(h, 64);
+        for (int i = 1; i <= GROWTH_STEPS; i++) {
+            char* q = (char*) MyAlloc_MallocFrom(h, (size_t) 64 << i);
+            memcpy(q, p, (size_t) 64 << (i - 1));
+            MyAlloc_FreeTo(h, p);
+            p = q;
+        }
+        MyAlloc_FreeTo(h, p);
+    }
+    MyAlloc_Destroy(h);
+}
+
+#define HOLE_COUNT      2000
+TEST_CASE("Benchmark fit search over many holes", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 32) / sizeof(uint64_t)];
+    static void* holes[HOLE_COUNT];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+    uint32_t seed = 12345;
+    int i;
+    
+    // Thousands of free holes of one size class, separated by used blocks, none of them fits exactly
+    REQUIRE(h != NULL);
+    for (i = 0; i < HOLE_COUNT; i++) {
+        holes[i] = MyAlloc_MallocFrom(h, 256 + ALIGNMENT * (1 + (seed = seed * 1103515245 + 12345) % 15));
+        REQUIRE(MyAlloc_MallocFrom(h, 16) != NULL);
+    }
+    for (i = 0; i < HOLE_COUNT; i++)
+        MyAlloc_FreeTo(h, holes[i]);
+    BENCHMARK("Fit among the holes") {
+        for (i = 0; i < HOLE_COUNT; i++)
+            MyAlloc_FreeTo(h, MyAlloc_MallocFrom(h, 256));
+    }
+    MyAlloc_Destroy(h);
+}
+
+#define POOL_SLOTS      1024
+#define POOL_ROUNDS     100000
+TEST_CASE("Benchmark power-of-two pools", "[.][benchmark]") {
+    static uint64_t region[(INSTANCE_SIZE * 256) / sizeof(uint64_t)];
+    static void* slots[POOL_SLOTS];
+    MY_ALLOC_CONFIG config = { false };
+    MY_ALLOC_ARENA_STATS stats;
+    size_t size, largest, trim;
+    uint32_t seed;
+    int round, slot, failures;
+    
+    // DMA buffer pools, random power-of-two buffers from 256 B to 64 KiB taken and released in random order,
+    // either of exactly 2^n bytes or trimmed by the header to fill a buddy block
+    printf("Buffers      | malloc+free (ns) | Failures | Used (KiB) | Largest free (KiB)\r\n");
+    for (trim = 0; trim <= METADATA_T_ALIGNED; trim += METADATA_T_ALIGNED) {
+        MY_ALLOC* h = MyAlloc_Create(region, sizeof(region), &config);
+        memset(slots, 0, sizeof(slots));
+        seed = 12345;
+        failures = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (round = 0; round < POOL_ROUNDS; round++) {
+            seed = seed * 1103515245 + 12345;
+            slot = (int) ((seed >> 8) % POOL_SLOTS);
+            if (slots[slot] != NULL) {
+                MyAlloc_FreeTo(h, slots[slot]);
+                slots[slot] = NULL;
+            } else if ((slots[slot] = MyAlloc_MallocFrom(h, ((size_t) 256 << ((seed >> 16) % 9)) - trim)) == NULL) {
+                failures++;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        REQUIRE(MyAlloc_GetHeapStats(h, &stats));
+        // Largest power-of-two buffer still available next to the live ones
+        for (largest = 0, size = sizeof(region); size >= 256 && largest == 0; size >>= 1) {
+            void* probe = MyAlloc_MallocFrom(h, size - trim);
+            if (probe != NULL) {
+                largest = size;
+                MyAlloc_FreeTo(h, probe);
+            }
+        }
+        printf("%-12s | %16.1f | %8d | %10lu | %18lu\r\n", trim ? "2^n - header" : "2^n", seconds * 1e9 / POOL_ROUNDS,
+               failures, (unsigned long) stats.usedSize / 1024, (unsigned long) largest / 1024);
+        MyAlloc_Destroy(h);
+    }
+}
+
+#if defined MY_ALLOC_USE_HUGE_PAGES
+#define TLB_OBJECTS     (1 << 20)
+#define TLB_ROUNDS      4
+
+// Counter of the dTLB load misses of the calling thread, -1 if the system does not provide it
+static int tlbCounterOpen(void) {
+    struct perf_event_attr attr;
+    
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Links the objects in random order and follows the chain, returns the time and the dTLB misses of each access
+template <typename Allocate, typename Release>
+static double tlbWorkload(Allocate allocate, Release release, size_t count, double* misses) {
+    std::vector<void**> objects(count);
+    std::vector<size_t> order(count);
+    std::mt19937 random(12345);
+    long long before = 0, after = 0;
+    size_t i;
+    int fd;
+    
+    for (i = 0; i < count; i++) {
+        objects[i] = (void**) allocate(64);
+        REQUIRE(objects[i] != nullptr);
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), random);
+    for (i = 0; i < count; i++)
+        *objects[order[i]] = objects[order[(i + 1) % count]];
+    
+    void** cursor = objects[order[0]];
+    fd = tlbCounterOpen();
+    if (fd >= 0 && read(fd, &before, sizeof(before)) != sizeof(before))
+        fd = -1;
+    auto start = std::chrono::steady_clock::now();
+    for (i = 0; i < count * TLB_ROUNDS; i++)
+        cursor = (void**) *cursor;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (fd >= 0 && read(fd, &after, sizeof(after)) != sizeof(after))
+        fd = -1;
+    if (fd >= 0)
+        close(fd);
+    *misses = fd >= 0 ? (double) (after - before) / (count * TLB_ROUNDS) : -1;
+    REQUIRE(cursor != nullptr);
+    for (i = 0; i < count; i++)
+        release(objects[i]);
+    return seconds * 1e9 / (count * TLB_ROUNDS);
+}
+
+TEST_CASE("Benchmark huge pages", "[.][benchmark]") {
+    MY_ALLOC_ARENA_STATS stats;
+    MY_ALLOC_CONFIG config = { false, true };
+    double seconds[2], misses[2];
+    size_t count, size;
+    int i;
+    
+    // Random pointer chase over small objects, as in a hash table or a graph, on the default heap backed by
+    // huge pages and on an instance of the same size whose region refuses them
+    REQUIRE(MyAlloc_GetArenaStats(0, &stats));
+    count = std::min((size_t) TLB_OBJECTS, stats.heapSize / 2 / 128);
+    size = stats.heapSize;
+    void* region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(region != MAP_FAILED);
+    madvise(region, size, MADV_NOHUGEPAGE);
+    MY_ALLOC* h = MyAlloc_Create(region, size, &config);
+    REQUIRE(h != NULL);
+    
+    seconds[0] = tlbWorkload([](size_t length) { return myMalloc(length); }, [](void* ptr) { myFree(ptr); }, count, &misses[0]);
+    seconds[1] = tlbWorkload([h](size_t length) { return MyAlloc_MallocFrom(h, length); }, [h](void* ptr) { MyAlloc_FreeTo(h, ptr); },
+                             count, &misses[1]);
+    printf("Pages (%lu objects) | Access (ns) | dTLB misses per access\r\n", (unsigned long) count);
+    for (i = 0; i < 2; i++) {
+        if (misses[i] < 0)
+            printf("%-19s | %11.1f | %22s\r\n", i ? "Base pages" : "Huge pages", seconds[i], "n/a");
+        else
+            printf("%-19s | %11.1f | %22.3f\r\n", i ? "Base pages" : "Huge pages", seconds[i], misses[i]);
+    }
+    MyAlloc_Destroy(h);
+    munmap(region, size);
+}
+#endif
+
+#define STRESS_SLOTS    16
+#define STRESS_ROUNDS   2000
+#if defined MY_ALLOC_USE_STATS
+#define STATS_THREADS       4
+#define STATS_ROUNDS        1000
+
+// Sum of the counters of every size class
+static uint64_t statsTotal(const uint64_t* counters) {
+    return std::accumulate(counters, counters + MY_ALLOC_STATS_CLASSES, (uint64_t) 0);
+}
+
+TEST_CASE("Testing stats") {
+    MY_ALLOC_ARENA_STATS arena;
+    MY_ALLOC_STATS before, during, after;
+    size_t size, heapSize = 0;
+    unsigned int i, allocClass = 0, freeClass = 0;
+    char *p1, *p2;
+    
+    for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+        REQUIRE(MyAlloc_GetArenaStats(i, &arena));
+        heapSize += arena.heapSize;
+    }
+    size = LARGE_REQUEST(arena.heapSize, 1, 4);
+    REQUIRE_FALSE(MyAlloc_GetStats(NULL));
+    
+    SECTION("Allocations and releases") {
+        INFO("A block must be counted once when allocated and once when released, in the same class") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetStats(&before));
+        p1 = (char*) myMalloc(100);
+        REQUIRE(p1 != NULL);
+        REQUIRE(MyAlloc_GetStats(&during));
+        myFree(p1);
+        REQUIRE(MyAlloc_GetStats(&after));
+        REQUIRE(statsTotal(during.allocs) == statsTotal(before.allocs) + 1);
+        REQUIRE(statsTotal(after.frees) == statsTotal(during.frees) + 1);
+        for (i = 0; i < MY_ALLOC_STATS_CLASSES; i++) {
+            if (during.allocs[i] != before.allocs[i])
+                allocClass = i;
+            if (after.frees[i] != during.frees[i])
+                freeClass = i;
+        }
+        REQUIRE(allocClass == freeClass);
+        REQUIRE(((size_t) 2 << allocClass) > 100);
+        REQUIRE(after.failures == before.failures);
+    }
+    
+    SECTION("Failures") {
+        INFO("A request larger than the heap must be counted as failed") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetStats(&before));
+        REQUIRE(myMalloc(2 * heapSize) == NULL);
+        REQUIRE(MyAlloc_GetStats(&after));
+        REQUIRE(after.failures == before.failures + 1);
+        REQUIRE(statsTotal(after.allocs) == statsTotal(before.allocs));
+    }
+    
+    SECTION("Gauges") {
+        INFO("Used and free bytes must cover the heap, the peak must follow the used bytes") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetStats(&before));
+        REQUIRE(before.usedSize + before.freeSize == heapSize);
+        REQUIRE(before.peakSize >= before.usedSize);
+        REQUIRE(before.blocks >= 1);
+        p1 = (char*) myMalloc(size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(MyAlloc_GetStats(&during));
+        REQUIRE(during.usedSize >= before.usedSize + size);
+        REQUIRE(during.peakSize >= during.usedSize);
+        myFree(p1);
+        REQUIRE(MyAlloc_GetStats(&after));
+        REQUIRE(after.usedSize + after.freeSize == heapSize);
+        REQUIRE(after.usedSize < during.usedSize);
+        REQUIRE(after.peakSize >= during.usedSize);
+    }
+    
+    SECTION("Splits and coalesces") {
+        INFO("Carving blocks must split free ones, releasing them must coalesce them") // Only appears on a FAIL
+        REQUIRE(MyAlloc_GetStats(&before));
+        p1 = (char*) myMalloc(size);
+        p2 = (char*) myMalloc(size);
+        REQUIRE(p1 != NULL);
+        REQUIRE(p2 != NULL);
+        REQUIRE(MyAlloc_GetStats(&during));
+        REQUIRE(during.splits > before.splits);
+        REQUIRE(during.blocks > before.blocks);
+        myFree(p1);
+        myFree(p2);
+        REQUIRE(MyAlloc_GetStats(&after));
+        REQUIRE(after.coalesces > during.coalesces);
+        REQUIRE(after.blocks < during.blocks);
+    }
+    
+#if MY_ALLOC_LOCK != MY_ALLOC_LOCK_NONE
+    SECTION("Threads") {
+        INFO("The counters of exited threads must be kept") // Only appears on a FAIL
+        std::vector<std::thread> threads;
+        REQUIRE(MyAlloc_GetStats(&before));
+        for (i = 0; i < STATS_THREADS; i++)
+            threads.emplace_back([]() {
+                for (int j = 0; j < STATS_ROUNDS; j++)
+                    myFree(myMalloc(16 + j % 512));
+            });
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(MyAlloc_GetStats(&after));
+        // Threads may find their arena full, failed requests are not released
+        REQUIRE(statsTotal(after.allocs) + after.failures == statsTotal(before.allocs) + before.failures + STATS_THREADS * STATS_ROUNDS);
+        REQUIRE(statsTotal(after.frees) - statsTotal(before.frees) == statsTotal(after.allocs) - statsTotal(before.allocs));
+    }
+#endif
+}
+#endif
+
+#define FRAGMENT_COUNT      8
+TEST_CASE("Testing fragmentation") {
+    MY_ALLOC_ARENA_STATS stats;
+    char *p[FRAGMENT_COUNT];
+    size_t largest;
+    double initial, fragmentation;
+    int i;
+    
+#if defined MY_ALLOC_USE_THREAD_CACHE
+    MyAlloc_FlushThreadCache();
+#endif
+    // Reading the stats of an arena also takes in the blocks released to it by other threads
+    for (i = MY_ALLOC_ARENAS - 1; i >= 0; i--)
+        REQUIRE(MyAlloc_GetArenaStats(i, &stats));
+    
+    SECTION("Largest free block") {
+        INFO("The largest free block must follow the blocks carved and released, no larger request can succeed") // Only appears on a FAIL
+        largest = 0;
+        for (i = 0; i < MY_ALLOC_ARENAS; i++) {
+            REQUIRE(MyAlloc_GetArenaStats(i, &stats));
+            largest = std::max(largest, stats.largestFree);
+        }
+        REQUIRE(MyAlloc_GetLargestFree() == largest);
+        REQUIRE(largest > 0);
+        REQUIRE(myMalloc(largest + ALIGNMENT) == NULL);
+        p[0] = (char*) myMalloc(LARGE_REQUEST(stats.heapSize, 1, 2));
+        REQUIRE(p[0] != NULL);
+        REQUIRE(MyAlloc_GetLargestFree() <= largest);
+        myFree(p[0]);
+        REQUIRE(MyAlloc_GetLargestFree() >= largest);
+    }
+    
+    SECTION("Fragmentation index") {
+        INFO("Holes between used blocks must raise the index, releasing the blocks must restore it") // Only appears on a FAIL
+        initial = MyAlloc_GetFragmentation();
+        for (i = 0; i < FRAGMENT_COUNT; i++) {
+            p[i] = (char*) myMalloc(stats.heapSize / 32);
+            REQUIRE(p[i] != NULL);
+        }
+        fragmentation = MyAlloc_GetFragmentation();
+        largest = MyAlloc_GetLargestFree();
+        REQUIRE(fragmentation >= 0.0);
+        REQUIRE(fragmentation < 1.0);
+        // The last block is left in place, it would merge with the free space that follows
+        for (i = 1; i < FRAGMENT_COUNT - 1; i += 2)
+            myFree(p[i]);
+#if defined MY_ALLOC_USE_THREAD_CACHE
+        MyAlloc_FlushThreadCache(); // Blocks of a small heap may be cached
+#endif
+        REQUIRE(MyAlloc_GetLargestFree() == largest);
+        REQUIRE(MyAlloc_GetFragmentation() > fragmentation);
+        for (i = 0; i < FRAGMENT_COUNT; i += 2)
+            myFree(p[i]);
+        myFree(p[FRAGMENT_COUNT - 1]);
+#if defined MY_ALLOC_USE_THREAD_CACHE
+        MyAlloc_FlushThreadCache();
+#endif
+        REQUIRE(MyAlloc_GetFragmentation() <= initial);
+    }
+}
+
+TEST_CASE("Testing random allocation stress") {
+    char *p[STRESS_SLOTS] = { NULL };
+    size_t len[STRESS_SLOTS] = { 0 };
+    uint32_t seed = 12345;
+    int i, j, round;
+    
+    SECTION("Payload integrity") {
+        INFO("Blocks must never overlap whatever the allocation algorithm") // Only appears on a FAIL
+        for (round = 0; round < STRESS_ROUNDS; round++) {
+            seed = seed * 1103515245 + 12345;
+            i = (seed >> 16) % STRESS_SLOTS;
+            if (p[i] != NULL) {
+                // Check the pattern written at allocation time is still there
+                for (j = 0; j < (int) len[i]; j++)
+                    REQUIRE(p[i][j] == (char) (i + j));
+                myFree(p[i]);
+                p[i] = NULL;
+            } else {
+                len[i] = 1 + (seed >> 8) % (MAX_HEAP_SIZE / STRESS_SLOTS);
+                p[i] = (char*) myMalloc(len[i]);
+                if (p[i] != NULL)
+                    for (j = 0; j < (int) len[i]; j++)
+                        p[i][j] = (char) (i + j);
+            }
+        }
+        for (i = 0; i < STRESS_SLOTS; i++)
+            myFree(p[i]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+
+#if defined MY_ALLOC_USE_THREAD_CACHE
+TEST_CASE("Testing thread cache") {
+    char *p1, *p2;
+    
+    SECTION("Cached block reuse") {
+        INFO("A freed small block must be served again by the thread cache") // Only appears on a FAIL
+        p1 = (char*) myMalloc(20);
+        REQUIRE(p1 != NULL);
+        myFree(p1);
+        p2 = (char*) myMalloc(19);
+        REQUIRE(p2 == p1);
+        REQUIRE_REQUESTED_SIZE(p2, 19);
+        myFree(p2);
+    }
+    
+    SECTION("Explicit flush") {
+        INFO("Flushed blocks must be free in the heap") // Only appears on a FAIL
+        p1 = (char*) myMalloc(8);
+        p2 = (char*) myMalloc(100);
+        myFree(p1);
+        myFree(p2);
+        MyAlloc_FlushThreadCache();
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+#endif
+
+#if MY_ALLOC_LOCK != MY_ALLOC_LOCK_NONE
+#define THREAD_SLOTS        4
+#define THREAD_ROUNDS       20000
+#define THREAD_MAX_COUNT    8
+
+// Each thread owns a few slots and checks its pattern before releasing them
+static void threadWorker(int id, int rounds, std::atomic<int>* corruptions) {
+    char *p[THREAD_SLOTS] = { NULL };
+    size_t len[THREAD_SLOTS] = { 0 };
+    uint32_t seed = 1 + id;
+    int i, round;
+    size_t j;
+    
+    for (round = 0; round < rounds; round++) {
+        seed = seed * 1103515245 + 12345;
+        i = (seed >> 16) % THREAD_SLOTS;
+        if (p[i] != NULL) {
+            for (j = 0; j < len[i]; j++)
+                if (p[i][j] != (char) (id + j))
+                    (*corruptions)++;
+            myFree(p[i]);
+            p[i] = NULL;
+        } else {
+            len[i] = 1 + (seed >> 8) % 24;
+            p[i] = (char*) myMalloc(len[i]);
+            if (p[i] != NULL)
+                for (j = 0; j < len[i]; j++)
+                    p[i][j] = (char) (id + j);
+        }
+    }
+    for (i = 0; i < THREAD_SLOTS; i++)
+        myFree(p[i]);
+}
+
+static double runThreads(int count, int rounds, std::atomic<int>* corruptions) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+        threads.push_back(std::thread(threadWorker, i, rounds, corruptions));
+    for (auto& t : threads)
+        t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+TEST_CASE("Testing multi-threaded stress", "[threads]") {
+    std::atomic<int> corruptions(0);
+    
+    SECTION("Concurrent allocations") {
+        INFO("Concurrent threads must never share a block") // Only appears on a FAIL
+        runThreads(THREAD_MAX_COUNT, THREAD_ROUNDS, &corruptions);
+        REQUIRE(corruptions == 0);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+
+TEST_CASE("Testing cross-thread release", "[threads]") {
+    char *p[ALLOC_MAX];
+    int i;
+    
+    SECTION("Producer/consumer") {
+        INFO("Blocks released by another thread must return to their arena") // Only appears on a FAIL
+        for (i = 0; i < ALLOC_MAX; i++) {
+            p[i] = (char*) myMalloc(10 + i);
+            REQUIRE(p[i] != NULL);
+        }
+        std::thread consumer([&p]() {
+            for (int j = 0; j < ALLOC_MAX; j++)
+                myFree(p[j]);
+        });
+        consumer.join();
+        // The producer reuses the released space
+        p[0] = (char*) myMalloc(LARGE_REQUEST(MAX_HEAP_SIZE / MY_ALLOC_ARENAS, 1, 2));
+        REQUIRE(p[0] != NULL);
+        myFree(p[0]);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+
+#if defined MY_ALLOC_USE_THREAD_CACHE
+#define SHARED_SLOTS        64
+
+static std::atomic<char*> sharedSlots[SHARED_SLOTS];
+
+// Checks the pattern of a shared block, its length is stored in front of the pattern
+static void checkShared(char* p, std::atomic<int>* corruptions) {
+    size_t len = *(size_t*) p, j;
+    for (j = sizeof(size_t); j < len; j++)
+        if (p[j] != (char) (len + j))
+            (*corruptions)++;
+}
+
+// Cached and not cached sizes end up side by side, blocks are released by any thread
+static void sharedWorker(int id, int rounds, std::atomic<int>* corruptions) {
+    uint32_t seed = 1 + id;
+    char *p;
+    size_t len, j;
+    int round;
+    
+    for (round = 0; round < rounds; round++) {
+        seed = seed * 1103515245 + 12345;
+        p = sharedSlots[(seed >> 16) % SHARED_SLOTS].exchange(NULL);
+        if (p == NULL) {
+            len = sizeof(size_t) + (seed >> 8) % (2 * THREAD_CACHE_MAX_SIZE);
+            if ((p = (char*) myMalloc(len)) == NULL)
+                continue;
+            *(size_t*) p = len;
+            for (j = sizeof(size_t); j < len; j++)
+                p[j] = (char) (len + j);
+            p = sharedSlots[(seed >> 16) % SHARED_SLOTS].exchange(p);
+            if (p == NULL)
+                continue;
+        }
+        checkShared(p, corruptions);
+        myFree(p);
+    }
+}
+
+TEST_CASE("Testing thread cache across threads", "[threads]") {
+    std::vector<std::thread> threads;
+    std::atomic<int> corruptions(0);
+    char* p;
+    int i;
+    
+    SECTION("Neighbours of cached blocks") {
+        INFO("Cached blocks must survive the coalescing of their neighbours") // Only appears on a FAIL
+        for (i = 0; i < THREAD_MAX_COUNT; i++)
+            threads.push_back(std::thread(sharedWorker, i, THREAD_ROUNDS, &corruptions));
+        for (auto& t : threads)
+            t.join();
+        for (i = 0; i < SHARED_SLOTS; i++)
+            if ((p = sharedSlots[i].exchange(NULL)) != NULL) {
+                checkShared(p, &corruptions);
+                myFree(p);
+            }
+        MyAlloc_FlushThreadCache();
+        REQUIRE(corruptions == 0);
+        REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+    }
+}
+#endif
+
+#if defined __unix__ && (MY_ALLOC_LOCK == MY_ALLOC_LOCK_PTHREAD || MY_ALLOC_LOCK == MY_ALLOC_LOCK_SPINLOCK)
+#define FORK_COUNT      200
+TEST_CASE("Testing fork", "[threads]") {
+    std::atomic<bool> stop(false);
+    int i, status, exited = 0;
+    
+    SECTION("Fork while another thread allocates") {
+        INFO("The child must not inherit a lock held by a thread that does not exist in it") // Only appears on a FAIL
+        std::thread worker([&stop]() {
+            while (!stop)
+                myFree(myMalloc(64));
+        });
+        for (i = 0; i < FORK_COUNT; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                alarm(5); // A deadlocked child is killed
+                void* p = myMalloc(64);
+                myFree(p);
+                _exit(p == NULL);
+            }
+            REQUIRE(waitpid(pid, &status, 0) == pid);
+            exited += WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        stop = true;
+        worker.join();
+        REQUIRE(exited == FORK_COUNT);
+    }
+}
+#endif
+
+TEST_CASE("Benchmark multi-threaded throughput", "[.][benchmark]") {
+    std::atomic<int> corruptions(0);
+    int count;
+    
+    printf("Threads | Operations/s | Scaling\r\n");
+    double base = 0;
+    for (count = 1; count <= THREAD_MAX_COUNT; count *= 2) {
+        double seconds = runThreads(count, THREAD_ROUNDS * 10, &corruptions);
+        double rate = (double) count * THREAD_ROUNDS * 10 / seconds;
+        if (count == 1)
+            base = rate;
+        printf("%7d | %12.0f | %6.2fx\r\n", count, rate, rate / base);
+    }
+    REQUIRE(corruptions == 0);
+    REQUIRE(MyAlloc_GetFreeNonLinearSpace() == MAX_HEAP_SIZE);
+}
+#endif
+
 //TEST_CASE("Testing Sample Class") {
 //    SampleClass sc;
 //